@@ -0,0 +1,54 @@
+#include "ChunkArena.h"
+
+ChunkArena::ChunkArena(size_t blockSize) : blockSize(blockSize)
+{
+}
+
+ChunkArena::~ChunkArena()
+{
+    clear();
+}
+
+void* ChunkArena::allocate(size_t size, size_t alignment)
+{
+    size_t start = (offset + alignment - 1) & ~(alignment - 1);
+
+    //start a new block when the last one is full, objects bigger than a block get one of their own
+    if(blocks.empty() || start + size > blocks.back().size)
+    {
+        Block block;
+        block.size = size > blockSize ? size : blockSize;
+        block.memory = (char*)::operator new(block.size);
+        blocks.push_back(block);
+
+        start = 0;
+    }
+
+    offset = start + size;
+    used += size;
+    return blocks.back().memory + start;
+}
+
+void ChunkArena::clear()
+{
+    for(auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+    {
+        it->destroy(it->object);
+    }
+    destructors.clear();
+
+    //evicted chunks should not hold on to any memory
+    for(auto& block : blocks)
+    {
+        ::operator delete(block.memory);
+    }
+    blocks.clear();
+
+    offset = 0;
+    used = 0;
+}
+
+size_t ChunkArena::getUsed()
+{
+    return used;
+}
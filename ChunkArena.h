@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//bump allocator owning the entities of a terrain chunk
+//objects are packed one after the other in large blocks and are all destroyed together by clear()
+class ChunkArena
+{
+    public:
+
+    ChunkArena(size_t blockSize = 64 * 1024);
+    ~ChunkArena();
+
+    ChunkArena(const ChunkArena&) = delete;
+    ChunkArena& operator=(const ChunkArena&) = delete;
+
+    //construct an object in the arena, it lives until the next clear()
+    template<typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "ChunkArena blocks are only aligned to max_align_t");
+
+        T* object = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if(!std::is_trivially_destructible<T>::value)
+        {
+            destructors.push_back({ object, [](void* pointer) { static_cast<T*>(pointer)->~T(); } });
+        }
+        return object;
+    }
+
+    //raw memory, aligned to alignment (a power of two)
+    void* allocate(size_t size, size_t alignment);
+
+    //destroy every object in reverse order of creation and free the blocks
+    void clear();
+
+    //bytes handed out since the last clear
+    size_t getUsed();
+
+    private:
+
+    struct Block
+    {
+        char* memory;
+        size_t size;
+    };
+
+    struct Destructor
+    {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    size_t blockSize;
+
+    std::vector<Block> blocks;
+    //offset of the free space in the last block
+    size_t offset = 0;
+    size_t used = 0;
+
+    std::vector<Destructor> destructors;
+};
+
+//allocator keeping a container's storage in a ChunkArena, for the arrays that live as long as the chunk's population
+//deallocate does nothing, the memory goes with the next clear()
+//so a container using it has to be replaced by an empty one before the arena is cleared, clear() keeps the old storage
+template<typename T>
+class ArenaAllocator
+{
+    public:
+
+    typedef T value_type;
+
+    ArenaAllocator(ChunkArena& arena) : arena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count)
+    {
+        return (T*)arena->allocate(count * sizeof(T), alignof(T));
+    }
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+    ChunkArena* arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,281 @@
+#include "ChunkBatch.h"
+#include "StrandBatch.h"
+#include "Renderable.h"
+#include "IndirectBatch.h"
+
+#include <cstddef>
+
+Uniform<int> ChunkBatch::batchModeUniform("batchMode");
+Uniform<int> ChunkBatch::swayTypeUniform("swayType");
+
+void ChunkBatch::clear()
+{
+    vertices.clear();
+    vertexCount = 0;
+    growing.clear();
+
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+
+    VBO = 0;
+    VAO = 0;
+
+    for(auto& group : groups)
+    {
+        if(group.indirect != nullptr)
+        {
+            group.indirect->remove(group.range);
+        }
+        glDeleteBuffers(1, &group.VBO);
+        glDeleteVertexArrays(1, &group.VAO);
+    }
+    groups.clear();
+
+    if(strands != nullptr)
+    {
+        strands->clear();
+        delete strands;
+        strands = nullptr;
+    }
+}
+
+void ChunkBatch::addVertex(const BatchVertex& vertex)
+{
+    vertices.push_back(vertex);
+}
+
+GLint ChunkBatch::nextVertex()
+{
+    return vertices.size();
+}
+
+void ChunkBatch::addGrowing(Renderable* entity)
+{
+    growing.push_back(entity);
+}
+
+void ChunkBatch::grow(int& budget)
+{
+    for(int i = 0; i < growing.size() && budget > 0;)
+    {
+        if(growing[i]->grow(*this, budget))
+        {
+            i++;
+        }
+        else
+        {
+            //fully grown, nothing left to write
+            growing[i] = growing.back();
+            growing.pop_back();
+        }
+    }
+}
+
+void ChunkBatch::updateVertices(GLint first, const std::vector<BatchVertex>& grown)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(BatchVertex) * first, sizeof(BatchVertex) * grown.size(), grown.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ChunkBatch::addInstance(const Mesh* mesh, int swayType, const BatchInstance& instance)
+{
+    //find the group for this mesh, create it if needed
+    for(auto& group : groups)
+    {
+        if(group.mesh == mesh)
+        {
+            group.instances.push_back(instance);
+            return;
+        }
+    }
+
+    InstanceGroup group;
+    group.mesh = mesh;
+    group.swayType = swayType;
+    group.instances.push_back(instance);
+
+    groups.push_back(group);
+}
+
+void ChunkBatch::addStrand(const Mesh* mesh, glm::vec3 axis, const BatchInstance& instance, float drag)
+{
+    if(strands == nullptr)
+    {
+        strands = new StrandBatch();
+    }
+    strands->add(mesh, axis, instance, drag);
+}
+
+StrandBatch* ChunkBatch::getStrands()
+{
+    return strands;
+}
+
+void ChunkBatch::upload()
+{
+    if(!vertices.empty())
+    {
+        // Generate buffers
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+
+        // Buffer object data
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        //growing entities rewrite parts of the buffer later on
+        glBufferData(GL_ARRAY_BUFFER, sizeof(BatchVertex) * vertices.size(), vertices.data(), growing.empty() ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (GLvoid*)offsetof(BatchVertex, position));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (GLvoid*)offsetof(BatchVertex, normal));
+        glEnableVertexAttribArray(1);
+
+        // Material palette index, read as an integer
+        glVertexAttribIPointer(2, 1, GL_UNSIGNED_SHORT, sizeof(BatchVertex), (GLvoid*)offsetof(BatchVertex, material));
+        glEnableVertexAttribArray(2);
+
+        // Sway attributes
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (GLvoid*)offsetof(BatchVertex, swayAxis));
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (GLvoid*)offsetof(BatchVertex, swayParams));
+        glEnableVertexAttribArray(6);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+
+        vertexCount = vertices.size();
+    }
+
+    //release cpu copy, the gpu owns the data from now on
+    std::vector<BatchVertex>().swap(vertices);
+
+    for(auto& group : groups)
+    {
+        if(IndirectBatch::isEnabled())
+        {
+            //culled one by one on the gpu, so every instance needs its own sphere
+            std::vector<Bounds> bounds(group.instances.size());
+            for(int i = 0; i < bounds.size(); i++)
+            {
+                bounds[i] = instanceBounds(group.mesh, group.instances[i]);
+            }
+
+            group.indirect = IndirectBatch::shared(group.mesh, group.swayType);
+            group.range = group.indirect->add(group.instances.data(), bounds.data(), group.instances.size());
+            group.instanceCount = group.instances.size();
+            std::vector<BatchInstance>().swap(group.instances);
+            continue;
+        }
+
+        glGenVertexArrays(1, &group.VAO);
+        glGenBuffers(1, &group.VBO);
+
+        glBindVertexArray(group.VAO);
+
+        // Shared mesh, one vertex per draw vertex
+        group.mesh->bindAttributes();
+
+        // Instance data, one element per instance
+        glBindBuffer(GL_ARRAY_BUFFER, group.VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(BatchInstance) * group.instances.size(), group.instances.data(), GL_STATIC_DRAW);
+        bindInstanceAttributes();
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+
+        group.instanceCount = group.instances.size();
+        std::vector<BatchInstance>().swap(group.instances);
+    }
+
+    if(strands != nullptr)
+    {
+        strands->upload();
+    }
+}
+
+void ChunkBatch::submit(RenderQueue& queue, Shader* shader, glm::vec3 center)
+{
+    // Unique geometry, one draw for every baked entity, the materials are in the vertices
+    if(vertexCount > 0)
+    {
+        DrawPacket packet;
+        packet.shader = shader;
+        packet.VAO = VAO;
+        packet.count = vertexCount;
+        packet.apply = applyBaked;
+        queue.submit(PASS_OPAQUE, packet, 0, center);
+    }
+
+    // Shared meshes, one instanced draw per mesh
+    for(auto& group : groups)
+    {
+        if(group.indirect != nullptr)
+        {
+            continue;
+        }
+
+        DrawPacket packet;
+        packet.shader = shader;
+        packet.VAO = group.VAO;
+        packet.count = group.mesh->vertexCount;
+        packet.instances = group.instanceCount;
+        packet.apply = applyGroup;
+        packet.owner = &group;
+        queue.submit(PASS_OPAQUE, packet, 0, center);
+    }
+
+    if(strands != nullptr)
+    {
+        strands->submit(queue, shader, center);
+    }
+}
+
+Bounds ChunkBatch::instanceBounds(const Mesh* mesh, const BatchInstance& instance)
+{
+    glm::vec3 extent = glm::max(glm::abs(mesh->boundsMin), glm::abs(mesh->boundsMax)) * instance.scale;
+
+    //sway moves the tip a little past the mesh bounds, as in Seaweed::getBounds
+    Bounds bounds;
+    bounds.center = glm::vec3(instance.model[3]);
+    bounds.radius = glm::length(extent) * 1.25f;
+    return bounds;
+}
+
+void ChunkBatch::applyBaked(Shader* shader, void* owner)
+{
+    shader->set(batchModeUniform, 1);
+}
+
+void ChunkBatch::applyInstances(Shader* shader, void* owner)
+{
+    shader->set(batchModeUniform, 2);
+    shader->set(swayTypeUniform, SWAY_NONE);
+}
+
+void ChunkBatch::applyGroup(Shader* shader, void* owner)
+{
+    InstanceGroup* group = (InstanceGroup*)owner;
+    shader->set(batchModeUniform, 2);
+    shader->set(swayTypeUniform, group->swayType);
+}
+
+void ChunkBatch::bindInstanceAttributes()
+{
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_SHORT, sizeof(BatchInstance), (GLvoid*)offsetof(BatchInstance, material));
+    glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(BatchInstance), (GLvoid*)offsetof(BatchInstance, phase));
+
+    // Model matrix takes one attribute per column
+    for(int i = 0; i < 4; i++)
+    {
+        glVertexAttribPointer(7 + i, 4, GL_FLOAT, GL_FALSE, sizeof(BatchInstance), (GLvoid*)(offsetof(BatchInstance, model) + i * sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(11, 3, GL_FLOAT, GL_FALSE, sizeof(BatchInstance), (GLvoid*)offsetof(BatchInstance, scale));
+
+    GLuint instanceAttributes[] = { 2, 6, 7, 8, 9, 10, 11 };
+    for(GLuint attribute : instanceAttributes)
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "Shader.h"
+#include "Material.h"
+#include "MeshArchive.h"
+#include "RenderQueue.h"
+#include "Components.h"
+
+class StrandBatch;
+class Renderable;
+class IndirectBatch;
+
+//vertex of baked static geometry
+//position and normal are already in world space, material and sway are stored per vertex
+struct BatchVertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+
+    //world direction the vertex is pushed along when swaying
+    glm::vec3 swayAxis;
+    //phase offset of the owning entity, weight of the first and second sway wave
+    glm::vec3 swayParams;
+
+    //entry in the MaterialPalette
+    uint16_t material;
+};
+
+//shear the shader applies to instanced meshes (swayType uniform, see mainlit.vs)
+//0 and 1 are the two seaweed shears, SWAY_NONE draws the mesh as it is
+const int SWAY_NONE = 2;
+
+//per instance data for entities sharing one mesh (ie seaweed)
+struct BatchInstance
+{
+    //model matrix applied after sway
+    glm::mat4 model;
+    //scale applied before sway
+    glm::vec3 scale;
+
+    //phase offset of the sway waves
+    float phase;
+
+    //entry in the MaterialPalette
+    uint16_t material;
+};
+
+//merges the static entities of a terrain chunk into a few draw calls
+//unique meshes are baked into one vertex buffer, shared meshes are drawn instanced
+class ChunkBatch
+{
+    public:
+
+    //discard all baked data and free the gpu buffers
+    void clear();
+
+    //add a vertex of unique static geometry
+    void addVertex(const BatchVertex& vertex);
+
+    //index the next added vertex gets
+    GLint nextVertex();
+
+    //entity whose baked vertices are not all final yet, it fills them in later with grow
+    void addGrowing(Renderable* entity);
+
+    //let the growing entities grow until the budget is spent
+    void grow(int& budget);
+
+    //overwrite uploaded vertices starting at first, only that range is sent to the gpu
+    void updateVertices(GLint first, const std::vector<BatchVertex>& grown);
+
+    //add an instance of a shared mesh
+    //swayType selects the shear the shader applies to the mesh (see mainlit.vs)
+    void addInstance(const Mesh* mesh, int swayType, const BatchInstance& instance);
+
+    //add an instance of a shared mesh simulated as a strand (see StrandBatch)
+    //axis is the direction of the strand in mesh space, drag scales the push of the current
+    void addStrand(const Mesh* mesh, glm::vec3 axis, const BatchInstance& instance, float drag);
+
+    //strands of the batch, null if it has none
+    StrandBatch* getStrands();
+
+    //upload baked data to the gpu and release the cpu copies
+    //with IndirectBatch enabled the instances go to the shared batch of their mesh instead
+    void upload();
+
+    //queue the draws of all baked geometry using specified shader, center is where the chunk is sorted from
+    //instances held by a shared IndirectBatch are drawn with it (see IndirectBatch::submitShared)
+    void submit(RenderQueue& queue, Shader* shader, glm::vec3 center);
+
+    //point the instance attributes (material, phase, model, scale) of the bound VAO
+    //at the bound buffer of BatchInstance
+    static void bindInstanceAttributes();
+
+    //uniforms of an instanced draw of a shared mesh that doesn't sway (see DrawPacket::apply)
+    static void applyInstances(Shader* shader, void* owner);
+
+    //how the shader reads the vertices (batchMode) and which shear it applies (swayType), see mainlit.vs
+    //shared by everything drawing batched or instanced geometry
+    static Uniform<int> batchModeUniform;
+    static Uniform<int> swayTypeUniform;
+
+    private:
+
+    //all instances of one shared mesh
+    struct InstanceGroup
+    {
+        const Mesh* mesh;
+        int swayType;
+
+        std::vector<BatchInstance> instances;
+        GLsizei instanceCount = 0;
+
+        GLuint VAO = 0;
+        GLuint VBO = 0;
+
+        //shared batch holding the instances and their range in it, when culled on the gpu
+        IndirectBatch* indirect = nullptr;
+        int range = -1;
+    };
+
+    std::vector<BatchVertex> vertices;
+    GLsizei vertexCount = 0;
+
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+
+    //entities with vertices reserved for later growth
+    std::vector<Renderable*> growing;
+
+    std::vector<InstanceGroup> groups;
+
+    //created by the first addStrand
+    StrandBatch* strands = nullptr;
+
+    //sphere around an instance of a shared mesh, model is taken to hold no scale
+    static Bounds instanceBounds(const Mesh* mesh, const BatchInstance& instance);
+
+    //uniforms of the baked draw and of an instance group's draw (see DrawPacket::apply)
+    static void applyBaked(Shader* shader, void* owner);
+    static void applyGroup(Shader* shader, void* owner);
+};
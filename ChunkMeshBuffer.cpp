@@ -0,0 +1,119 @@
+#include "ChunkMeshBuffer.h"
+
+#include <cassert>
+
+ChunkMeshBuffer::~ChunkMeshBuffer()
+{
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+}
+
+GLint ChunkMeshBuffer::allocate(const std::vector<glm::vec3>& vertices)
+{
+    GLsizei vertexCount = vertices.size() / 2;
+    if(slotVertices == 0)
+    {
+        slotVertices = vertexCount;
+    }
+    //every chunk has as many points, a mesh of another size is a bug in the mesh building
+    assert(vertexCount == slotVertices && "chunk mesh doesn't fit the slots");
+
+    int slot;
+    if(!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        if(used == capacity)
+        {
+            grow();
+        }
+        slot = used++;
+    }
+
+    GLint first = slot * slotVertices;
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * 2 * first, sizeof(glm::vec3) * vertices.size(), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return first;
+}
+
+void ChunkMeshBuffer::release(GLint first)
+{
+    freeSlots.push_back(first / slotVertices);
+}
+
+void ChunkMeshBuffer::begin()
+{
+    firsts.clear();
+    counts.clear();
+}
+
+void ChunkMeshBuffer::add(GLint first)
+{
+    firsts.push_back(first);
+    counts.push_back(slotVertices);
+}
+
+void ChunkMeshBuffer::submit(RenderQueue& queue, Shader* shader, uint16_t material, glm::vec3 center, void (*apply)(Shader*, void*), void* owner)
+{
+    if(firsts.empty())
+    {
+        return;
+    }
+
+    DrawPacket packet;
+    packet.shader = shader;
+    packet.VAO = VAO;
+    packet.count = firsts.size();
+    packet.firsts = firsts.data();
+    packet.counts = counts.data();
+    packet.apply = apply;
+    packet.owner = owner;
+    queue.submit(PASS_OPAQUE, packet, material, center);
+}
+
+void ChunkMeshBuffer::grow()
+{
+    int grown = capacity == 0 ? 16 : capacity * 2;
+    GLsizeiptr slotSize = sizeof(glm::vec3) * 2 * slotVertices;
+
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, slotSize * grown, NULL, GL_STATIC_DRAW);
+
+    //meshes already in the old buffer move over without passing through the cpu
+    if(VBO != 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, slotSize * used);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &VBO);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    VBO = buffer;
+    capacity = grown;
+
+    if(VAO == 0)
+    {
+        glGenVertexArrays(1, &VAO);
+    }
+
+    // Point the attributes at the new buffer
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
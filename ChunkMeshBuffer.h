@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "Shader.h"
+#include "RenderQueue.h"
+
+//ground meshes of the loaded chunks suballocated from one vertex buffer behind one vertex array
+//every chunk mesh has as many vertices, so the buffer is cut in equal slots and freed slots are reused
+//the chunks the culling keeps add their slot each frame and are drawn together by one glMultiDrawArrays
+class ChunkMeshBuffer
+{
+    public:
+
+    ~ChunkMeshBuffer();
+
+    //copy a mesh of interleaved positions and normals into a free slot, returns its first vertex
+    //the first mesh sets the slot size and every later one has to match it, the buffer doubles when it is full
+    GLint allocate(const std::vector<glm::vec3>& vertices);
+    //free the slot starting at first
+    void release(GLint first);
+
+    //forget the draws of the last frame
+    void begin();
+    //draw the slot starting at first this frame
+    void add(GLint first);
+    //queue one multi draw of the slots added since begin, apply and owner set the uniforms (see DrawPacket)
+    void submit(RenderQueue& queue, Shader* shader, uint16_t material, glm::vec3 center, void (*apply)(Shader*, void*), void* owner);
+
+    private:
+
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+
+    GLsizei slotVertices = 0;
+    //slots the buffer has room for and slots handed out at least once
+    int capacity = 0;
+    int used = 0;
+    std::vector<int> freeSlots;
+
+    //first vertex and vertex count of every draw of the frame, read by the queue when it executes
+    std::vector<GLint> firsts;
+    std::vector<GLsizei> counts;
+
+    //move the meshes to a buffer twice as large
+    void grow();
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <GLM\glm.hpp>
+
+//components shared by the packed entity stores (see SlotMap.h)
+
+//placement of an entity, model is rebuilt by the owning system every update
+struct Transform
+{
+    glm::vec3 position;
+    glm::vec3 scale = glm::vec3(1.0f);
+
+    //rotation and translation, scale is applied separately so it can be sent per instance
+    glm::mat4 model;
+};
+
+//world space bounding sphere
+struct Bounds
+{
+    glm::vec3 center;
+    float radius = 0.0f;
+};
@@ -20,6 +20,11 @@ float ConfigSection::getFloat(std::string key)
     return std::stof(values[key]);
 }
 
+std::string ConfigSection::getString(std::string key)
+{
+    return values[key];
+}
+
 void ConfigSection::setSection(std::string key, ConfigSection* section)
 {
     subSectons[key] = section;
@@ -12,6 +12,7 @@ class ConfigSection
     int getInt(std::string);
     double getDouble(std::string);
     float getFloat(std::string);
+    std::string getString(std::string);
     
     void setSection(std::string key, ConfigSection* section);
     ConfigSection* getSection(std::string key);
@@ -2,22 +2,68 @@
 
 #include <GLM\gtc\matrix_transform.hpp>
 #include <GLM\gtc\type_ptr.hpp>
-#include <random>
 
 #include "Coral.h"
+#include "ChunkBatch.h"
 
-Coral::Coral(glm::vec3 position) : position(position)
+#include <algorithm>
+
+float Coral::growthInterval = 30.0f;
+float Coral::clock = 0.0f;
+
+Coral::Coral(glm::vec3 position, uint64_t seed, const CoralGrowth* growth) : position(position), seed(seed)
 {
-    // Random devices and distributions
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> randLength(0.5, 1.5);
-    std::uniform_real_distribution<> randWidth(1.0, 3.0);
-    std::uniform_real_distribution<> u(0.0, 1.0);
-    std::uniform_real_distribution<> v(-0.2, 0.2);
+    // Random generator, the whole tree comes from this one seed
+    Random random(seed);
+    
+    generateGeometry(random, levels - 1);
+    vertexCount = vertices.size();
+    for (auto& vertex : vertices)
+    {
+        extent = std::max(extent, glm::length(vertex));
+    }
+    // bake and load rebuild the levels they need
+    releaseGeometry();
     
-    float wc = randWidth(gen) * 0.5;
-    float lc = wc*5.0f*randLength(gen);
+    model = glm::translate(glm::mat4(1.0f), -position);
+    
+    oscOffset = random.uniform()*3.14159265;
+    
+    float baseColor = random.uniform(-0.2f, 0.2f);
+    glm::vec3 color;
+    color.x = random.uniform() + baseColor;
+    color.y = random.uniform() + baseColor;
+    color.z = random.uniform() + baseColor;
+    
+    // Assign material 
+    material = Material(glm::vec3(0.25f), color, glm::vec3(0.25f), 0.4f);
+    
+    // Corals are found at every stage of growth, drawn after everything else so the shape and colour stay the same
+    // A coral that grew before carries on from there
+    if (growth != nullptr)
+    {
+        grownLevel = growth->level;
+        nextGrowth = growth->nextGrowth;
+    }
+    else
+    {
+        grownLevel = random.range(levels);
+        nextGrowth = clock + growthInterval * random.uniform(0.5f, 1.5f);
+    }
+}
+
+CoralGrowth Coral::getGrowth()
+{
+    CoralGrowth growth;
+    growth.level = grownLevel;
+    growth.nextGrowth = nextGrowth;
+    return growth;
+}
+
+void Coral::generateGeometry(Random& random, int upTo)
+{
+    float wc = random.uniform(1.0f, 3.0f) * 0.5;
+    float lc = wc*5.0f*random.uniform(0.5f, 1.5f);
     
     // Base triangle
     glm::vec3 v0 = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -29,52 +75,36 @@ Coral::Coral(glm::vec3 position) : position(position)
     //Push base triangle
     pushTriangle(v0, v1, v2, normal);
     
-    tree(v0, v1, v2, 4, lc, wc);
-    
-    loadBuffers();
-    
-    model = glm::translate(glm::mat4(1.0f), -position);
-    
-    oscOffset = u(gen)*3.14159265;
-    
-    float baseColor = v(gen);
-    glm::vec3 color = glm::vec3(u(gen) + baseColor, u(gen) + baseColor, u(gen) + baseColor);
-    
-    // Assign material 
-    material = Material(glm::vec3(0.25f), color, glm::vec3(0.25f), 0.4f);
-    
+    // The trunk grows out of the base triangle, every level after it out of the tips of the previous one
+    Branch trunk;
+    trunk.v0 = v0;
+    trunk.v1 = v1;
+    trunk.v2 = v2;
+    trunk.lc = lc;
+    trunk.seed = random.next64();
+    frontier.assign(1, trunk);
     
+    for (int level = 0; level <= upTo; level++)
+    {
+        growFrontier(level);
+        levelEnd[level] = vertices.size();
+    }
+}
+
+void Coral::growFrontier(int level)
+{
+    std::vector<Branch> tips;
+    for (auto& branch : frontier)
+    {
+        tree(branch, level, tips);
+    }
+    frontier.swap(tips);
 }
 
-void Coral::render(Shader * shader)
+GLsizei Coral::drawCount()
 {
-    //shader->use();
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse(model));
-    
-    // Broadcast the uniform values to the shaders
-    GLuint modelLoc = glGetUniformLocation(shader->program, "model");
-    GLint matAmbientLoc = glGetUniformLocation(shader->program, "material.ambient");
-    GLint matDiffuseLoc = glGetUniformLocation(shader->program, "material.diffuse");
-    GLint matSpecularLoc = glGetUniformLocation(shader->program, "material.specular");
-    GLint matShineLoc = glGetUniformLocation(shader->program, "material.shininess");
-    GLint normalMatrixLoc = glGetUniformLocation(shader->program, "normalMatrix");
-    //GLuint viewLoc = glGetUniformLocation(shader->program, "view");
-    //GLuint projectionLoc = glGetUniformLocation(shader->program, "projection");
-    
-    
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniform3f(matAmbientLoc, material.ambient.x, material.ambient.y, material.ambient.z);
-    glUniform3f(matDiffuseLoc, material.diffuse.x, material.diffuse.y, material.diffuse.z);
-    glUniform3f(matSpecularLoc, material.specular.x, material.specular.y, material.specular.z);
-    glUniform1f(matShineLoc, material.shininess);
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-    //glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    //glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    
-    // Draw object
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-    glBindVertexArray(0);
+    // Levels are stored in order, the grown ones come first
+    return levelEnd[grownLevel];
 }
 
 void Coral::animate(float deltaTime)
@@ -97,19 +127,99 @@ void Coral::animate(float deltaTime)
     model = tempModel;
 }
 
-void Coral::tree(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, int r, float lc, float wc)
+Bounds Coral::getBounds()
+{
+    // At full sway (currentSway in mainlit.vs stops there) a vertex moves up by at most |x| / 25 + |z| / 25.153
+    // which is under sqrt(2) / 25 of its distance from the base
+    Bounds bounds;
+    bounds.center = -position;
+    bounds.radius = extent * (1.0f + 1.415f / 25.0f);
+    return bounds;
+}
+
+bool Coral::bake(ChunkBatch& batch)
 {
-    // Random devices and distributions
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::poisson_distribution<> p(10);
-    std::uniform_real_distribution<> u(0.5, 0.9);
-    std::uniform_real_distribution<> u3(0.1, 0.3);
-    std::uniform_real_distribution<> u1(0.0, 1.0);
-    std::uniform_real_distribution<> u2(5.0, 15.0);
+    // Only the grown levels, the frontier is left at their tips for grow
+    Random random(seed);
+    generateGeometry(random, grownLevel);
     
-    float lv = u(gen);
-    float wv = u3(gen);
+    batchFirst = batch.nextVertex();
+    
+    // Room is kept for the levels still to grow, collapsed to the base until then so they draw nothing
+    BatchVertex collapsed = bakeVertex(0);
+    collapsed.position = -position;
+    collapsed.swayParams = glm::vec3(oscOffset, 0.0f, 0.0f);
+    
+    for (int i = 0; i < vertexCount; i++)
+    {
+        batch.addVertex(i < vertices.size() ? bakeVertex(i) : collapsed);
+    }
+    
+    if (grownLevel < levels - 1)
+    {
+        batch.addGrowing(this);
+    }
+    
+    // the batch has its own copy now
+    releaseGeometry();
+    
+    return true;
+}
+
+bool Coral::grow(ChunkBatch& batch, int& budget)
+{
+    if (clock < nextGrowth)
+    {
+        return true;
+    }
+    
+    // Only the new level is generated, out of the tips of the last one, and written into the space bake kept for it
+    growFrontier(grownLevel + 1);
+    
+    std::vector<BatchVertex> grown;
+    grown.reserve(vertices.size());
+    for (int i = 0; i < vertices.size(); i++)
+    {
+        grown.push_back(bakeVertex(i));
+    }
+    batch.updateVertices(batchFirst + levelEnd[grownLevel], grown);
+    
+    releaseGeometry();
+    
+    grownLevel++;
+    budget--;
+    
+    // Same spread as the first level, the phase is already random per coral
+    nextGrowth = clock + growthInterval * (0.5f + oscOffset / 3.14159265f);
+    
+    return grownLevel < levels - 1;
+}
+
+BatchVertex Coral::bakeVertex(int i)
+{
+    BatchVertex vertex;
+    vertex.material = material.index;
+    
+    // Same shear as animate(), vertices are pushed up by their offset from the base
+    vertex.swayAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+    
+    vertex.position = vertices[i] - position;
+    vertex.normal = normals[i];
+    vertex.swayParams = glm::vec3(oscOffset, vertices[i].x / 25.0f, vertices[i].z / 25.153f);
+    
+    return vertex;
+}
+
+void Coral::tree(const Branch& branch, int level, std::vector<Branch>& tips)
+{
+    // Every branch has its own stream, so a level can be grown without the ones before it
+    Random random(branch.seed);
+    glm::vec3 v0 = branch.v0;
+    glm::vec3 v1 = branch.v1;
+    glm::vec3 v2 = branch.v2;
+    float lc = branch.lc;
+    
+    float wv = random.uniform(0.1f, 0.3f);
     
     
     glm::vec3 centroid = glm::vec3((v0.x + v1.x + v2.x) / 3, (v0.y + v1.y + v2.y) / 3, (v0.z + v1.z + v2.z) / 3);
@@ -159,16 +269,23 @@ void Coral::tree(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, int r, float lc, floa
     
     
     
-    if (r > 0)
+    if (level < levels - 1)
     {
-        if (u1(gen) < 0.9f)
-            tree(v3, v4, v6, r - 1, lc * u(gen), edgeLength);
-        if (u1(gen) < 0.9f)
-            tree(v4, v5, v6, r - 1, lc * u(gen), edgeLength);
-        if (u1(gen) < 0.9f)
-            tree(v5, v3, v6, r - 1, lc * u(gen), edgeLength);
-        if (u1(gen) < 0.9f)
-            tree(v3, v4, v5, r - 1, lc * u(gen), edgeLength);
+        // Each of the four new faces branches out with the same odds
+        glm::vec3 faces[4][3] = { { v3, v4, v6 }, { v4, v5, v6 }, { v5, v3, v6 }, { v3, v4, v5 } };
+        for (int i = 0; i < 4; i++)
+        {
+            if (random.uniform() < 0.9f)
+            {
+                Branch tip;
+                tip.v0 = faces[i][0];
+                tip.v1 = faces[i][1];
+                tip.v2 = faces[i][2];
+                tip.lc = lc * random.uniform(0.5f, 0.9f);
+                tip.seed = random.next64();
+                tips.push_back(tip);
+            }
+        }
     }
     
 }
@@ -189,6 +306,25 @@ bool Coral::load()
 {
     if(VAO == 0)
     {
+        // geometry was released after an earlier upload or bake
+        if (vertices.empty())
+        {
+            Random random(seed);
+            generateGeometry(random, levels - 1);
+        }
+        
+        // Interleave positions and normals
+        std::vector<GLfloat> data(vertices.size() * 6);
+        for (int i = 0; i < vertices.size(); i++)
+        {
+            data[(i * 6)] = vertices[i].x;
+            data[(i * 6) + 1] = vertices[i].y;
+            data[(i * 6) + 2] = vertices[i].z;
+            data[(i * 6) + 3] = normals[i].x;
+            data[(i * 6) + 4] = normals[i].y;
+            data[(i * 6) + 5] = normals[i].z;
+        }
+        
         // Generate buffers
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -197,7 +333,7 @@ bool Coral::load()
         // Buffer object data
         glBindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * (sizeof(GLfloat) * 6), data, GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), data.data(), GL_STATIC_DRAW);
         
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
         glEnableVertexAttribArray(0);
@@ -207,7 +343,9 @@ bool Coral::load()
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
         
-        true;
+        releaseGeometry();
+        
+        return true;
         
     }
     return false;
@@ -223,18 +361,8 @@ void Coral::unload()
     VAO = 0;
 }
 
-void Coral::loadBuffers()
+void Coral::releaseGeometry()
 {
-    
-    data = new GLfloat[vertices.size() * 6];
-    
-    for (int i = 0; i < vertices.size(); i++)
-    {
-        data[(i * 6)] = vertices[i].x;
-        data[(i * 6) + 1] = vertices[i].y;
-        data[(i * 6) + 2] = vertices[i].z;
-        data[(i * 6) + 3] = normals[i].x;
-        data[(i * 6) + 4] = normals[i].y;
-        data[(i * 6) + 5] = normals[i].z;
-    }
+    Renderable::releaseGeometry();
+    std::vector<glm::vec3>().swap(normals);
 }
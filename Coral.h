@@ -1,16 +1,37 @@
 #pragma once
 
 #include "Renderable.h"
+#include "Random.h"
 
+struct BatchVertex;
+
+// how far a coral has grown, kept by its chunk while the coral is depopulated
+struct CoralGrowth
+{
+    int level;
+    float nextGrowth;
+};
 
 class Coral : public Renderable
 {
     
     public:
-    Coral(glm::vec3 position);
+    // growth restores a coral spawned before, otherwise it starts at a random level
+    Coral(glm::vec3 position, uint64_t seed, const CoralGrowth* growth = nullptr);
     
-    void render(Shader* shader);
+    GLsizei drawCount();
     void animate(float deltaTime);
+    Bounds getBounds();
+    bool bake(ChunkBatch& batch);
+    bool grow(ChunkBatch& batch, int& budget);
+    CoralGrowth getGrowth();
+    
+    // branch levels of a fully grown coral, the trunk is level 0
+    static const int levels = 5;
+    // seconds between two levels, on average
+    static float growthInterval;
+    // time every coral grows against, advanced by Terrain
+    static float clock;
     
     std::vector<glm::vec3> normals;
     
@@ -18,13 +39,46 @@ class Coral : public Renderable
     
     private:
     
-    void tree(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, int r, float lc, float wc);
+    // branch still to be grown, from its base triangle, with its length and the seed of its own random stream
+    struct Branch
+    {
+        glm::vec3 v0, v1, v2;
+        float lc;
+        uint64_t seed;
+    };
+    
+    // fill vertices and normals with levels 0 to upTo, uses the first draws of the coral's random stream
+    // the tree is grown level by level so every level is one range after the previous one
+    void generateGeometry(Random& random, int upTo);
+    // append the triangles of level, grown out of the frontier, which is left at the tips of the new branches
+    void growFrontier(int level);
+    void tree(const Branch& branch, int level, std::vector<Branch>& tips);
     void pushTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, glm::vec3 n);
-    void loadBuffers();
+    // vertex i as baked into a chunk batch
+    BatchVertex bakeVertex(int i);
+    // free vertices and normals once they are uploaded or baked
+    void releaseGeometry();
     
     bool load();
     void unload();
-    GLfloat * data;
+    
+    // seed the coral was made from, the geometry is rebuilt from it after being released
+    uint64_t seed;
+    // number of vertices, still known once the geometry is released
+    GLsizei vertexCount;
+    // distance from the base to the furthest vertex of the fully grown coral
+    float extent = 0.0f;
+    
+    // branches the next level grows out of, kept between growth steps so only that level is generated
+    std::vector<Branch> frontier;
+    // vertices up to the end of each level
+    GLsizei levelEnd[levels];
+    // last level grown so far
+    int grownLevel;
+    // clock time of the next level
+    float nextGrowth;
+    // where the coral's vertices start in the batch it was baked in
+    GLint batchFirst = 0;
     
     // Variables for periodic animations
     GLfloat totalTime = 0.0f;
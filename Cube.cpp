@@ -13,6 +13,8 @@
 
 Cube::Cube(float edgeLength, glm::vec3 eulerXYZ, glm::vec3 position)
 {
+	// Half the diagonal, reaches every corner
+	radius = edgeLength * 0.8660254f;
 	
 	
 	//Compute surface normals for cube
@@ -108,28 +110,8 @@ Cube::Cube(float edgeLength, glm::vec3 eulerXYZ, glm::vec3 position)
 }
 
 
-void Cube::render(Shader* shader)
+GLsizei Cube::drawCount()
 {
-	glm::mat3 normalMatrix = glm::transpose(glm::inverse(model));
-
-
-	GLint matAmbientLoc = glGetUniformLocation(shader->program, "material.ambient");
-	GLint matDiffuseLoc = glGetUniformLocation(shader->program, "material.diffuse");
-	GLint matSpecularLoc = glGetUniformLocation(shader->program, "material.specular");
-	GLint matShineLoc = glGetUniformLocation(shader->program, "material.shininess");
-	GLint normalMatrixLoc = glGetUniformLocation(shader->program, "normalMatrix");
-	GLuint modelLoc = glGetUniformLocation(shader->program, "model");
-
-	glUniform3f(matAmbientLoc, material.ambient.x, material.ambient.y, material.ambient.z);
-	glUniform3f(matDiffuseLoc, material.diffuse.x, material.diffuse.y, material.diffuse.z);
-	glUniform3f(matSpecularLoc, material.specular.x, material.specular.y, material.specular.z);
-	glUniform1f(matShineLoc, material.shininess);
-	glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-
-	glBindVertexArray(VAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+	return 36;
 }
 
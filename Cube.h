@@ -14,7 +14,7 @@ public:
 
 	Cube(float edgeLength, glm::vec3 eulerXYZ, glm::vec3 position);
 	
-	void Cube::render(Shader* shader) override;
+	GLsizei drawCount() override;
 
 
 private:
@@ -0,0 +1,214 @@
+#include "Culling.h"
+
+#include <algorithm>
+#include <xmmintrin.h>
+
+//spheres per job when testing on the workers
+static const int sphereBlock = 1024;
+
+static_assert(sizeof(Bounds) == 4 * sizeof(float), "a Bounds is loaded as one sse register");
+
+void Frustum::set(const glm::mat4& viewProjection, glm::vec3 viewPos, float fogDistance)
+{
+    this->viewPos = viewPos;
+    this->fogDistance = fogDistance;
+
+    //rows of the matrix, glm stores columns
+    glm::vec4 rows[4];
+    for(int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    //left, right, bottom, top, near, far
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[3] + rows[2];
+    planes[5] = rows[3] - rows[2];
+
+    for(auto& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+Visibility Frustum::test(const BoundingBox& box) const
+{
+    if(box.isEmpty())
+    {
+        return OUTSIDE;
+    }
+
+    Visibility result = INSIDE;
+    for(auto& plane : planes)
+    {
+        glm::vec3 normal(plane);
+
+        //corner furthest along the normal, if it is behind the plane the whole box is
+        glm::vec3 furthest(normal.x > 0.0f ? box.max.x : box.min.x, normal.y > 0.0f ? box.max.y : box.min.y, normal.z > 0.0f ? box.max.z : box.min.z);
+        if(glm::dot(normal, furthest) + plane.w < 0.0f)
+        {
+            return OUTSIDE;
+        }
+
+        //corner nearest the plane, behind it the box crosses the plane
+        glm::vec3 nearest(normal.x > 0.0f ? box.min.x : box.max.x, normal.y > 0.0f ? box.min.y : box.max.y, normal.z > 0.0f ? box.min.z : box.max.z);
+        if(glm::dot(normal, nearest) + plane.w < 0.0f)
+        {
+            result = INTERSECTING;
+        }
+    }
+
+    //flat distance to the closest and furthest point of the box
+    glm::vec2 view(viewPos.x, viewPos.z);
+    glm::vec2 low(box.min.x, box.min.z);
+    glm::vec2 high(box.max.x, box.max.z);
+    glm::vec2 closest = glm::clamp(view, low, high) - view;
+    if(glm::dot(closest, closest) > fogDistance * fogDistance)
+    {
+        return OUTSIDE;
+    }
+    glm::vec2 furthest = glm::max(glm::abs(low - view), glm::abs(high - view));
+    if(glm::dot(furthest, furthest) > fogDistance * fogDistance)
+    {
+        result = INTERSECTING;
+    }
+
+    return result;
+}
+
+bool Frustum::test(const Bounds& sphere, bool fog) const
+{
+    for(auto& plane : planes)
+    {
+        if(glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+        {
+            return false;
+        }
+    }
+
+    if(fog)
+    {
+        glm::vec2 offset(sphere.center.x - viewPos.x, sphere.center.z - viewPos.z);
+        float reach = fogDistance + sphere.radius;
+        if(glm::dot(offset, offset) > reach * reach)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Frustum::test(const Bounds* spheres, int count, uint8_t* visible, bool fog) const
+{
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for(int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm_set1_ps(planes[p].x);
+        planeY[p] = _mm_set1_ps(planes[p].y);
+        planeZ[p] = _mm_set1_ps(planes[p].z);
+        planeW[p] = _mm_set1_ps(planes[p].w);
+    }
+    const __m128 viewX = _mm_set1_ps(viewPos.x);
+    const __m128 viewZ = _mm_set1_ps(viewPos.z);
+    const __m128 fogReach = _mm_set1_ps(fog ? fogDistance : 1e18f);
+
+    int packed = count & ~3;
+    for(int i = 0; i < packed; i += 4)
+    {
+        //four spheres in, x, y, z and radius of all four out
+        __m128 x = _mm_loadu_ps(&spheres[i].center.x);
+        __m128 y = _mm_loadu_ps(&spheres[i + 1].center.x);
+        __m128 z = _mm_loadu_ps(&spheres[i + 2].center.x);
+        __m128 radius = _mm_loadu_ps(&spheres[i + 3].center.x);
+        _MM_TRANSPOSE4_PS(x, y, z, radius);
+
+        //outside as soon as one plane has the whole sphere behind it
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+        __m128 outside = _mm_setzero_ps();
+        for(int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])), _mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+        }
+
+        __m128 dx = _mm_sub_ps(x, viewX);
+        __m128 dz = _mm_sub_ps(z, viewZ);
+        __m128 reach = _mm_add_ps(fogReach, radius);
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)), _mm_mul_ps(reach, reach)));
+
+        int mask = _mm_movemask_ps(outside);
+        for(int j = 0; j < 4; j++)
+        {
+            visible[i + j] = ((mask >> j) & 1) == 0;
+        }
+    }
+
+    for(int i = packed; i < count; i++)
+    {
+        visible[i] = test(spheres[i], fog);
+    }
+}
+
+Culler::Culler(WorkerPool& pool) : pool(pool)
+{
+}
+
+void Culler::begin(const glm::mat4& view, const glm::mat4& projection, glm::vec3 viewPos, float fogDistance)
+{
+    frustum.set(projection * view, viewPos, fogDistance);
+    horizon.clear();
+}
+
+const Frustum& Culler::getFrustum()
+{
+    return frustum;
+}
+
+HorizonBuffer& Culler::getHorizon()
+{
+    return horizon;
+}
+
+void Culler::test(const Bounds* spheres, int count, uint8_t* visible, bool fog)
+{
+    if(count <= sphereBlock)
+    {
+        testBlock(spheres, count, visible, fog);
+        return;
+    }
+
+    pool.parallelFor((count + sphereBlock - 1) / sphereBlock, [this, spheres, visible, count, fog](int block)
+    {
+        int start = block * sphereBlock;
+        testBlock(spheres + start, std::min(sphereBlock, count - start), visible + start, fog);
+    });
+}
+
+void Culler::test(const std::vector<Bounds>& spheres, std::vector<uint8_t>& visible, bool fog)
+{
+    visible.resize(spheres.size());
+    test(spheres.data(), spheres.size(), visible.data(), fog);
+}
+
+void Culler::testBlock(const Bounds* spheres, int count, uint8_t* visible, bool fog)
+{
+    frustum.test(spheres, count, visible, fog);
+
+    //the horizon only for what the view kept, it costs more per sphere
+    for(int i = 0; i < count; i++)
+    {
+        if(visible[i] && horizon.isOccluded(spheres[i]))
+        {
+            visible[i] = 0;
+        }
+    }
+}
+
+void Culler::parallelFor(int count, const std::function<void(int)>& job)
+{
+    pool.parallelFor(count, job);
+}
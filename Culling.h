@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <GLM\glm.hpp>
+
+#include "Components.h"
+#include "WorkerPool.h"
+#include "Horizon.h"
+
+//world space axis aligned box, empty until something is added
+struct BoundingBox
+{
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+
+    bool isEmpty() const { return min.x > max.x; };
+
+    void add(glm::vec3 point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    };
+    void add(const Bounds& sphere)
+    {
+        min = glm::min(min, sphere.center - sphere.radius);
+        max = glm::max(max, sphere.center + sphere.radius);
+    };
+    void add(const BoundingBox& box)
+    {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    };
+};
+
+//result of testing a box, INSIDE means everything in it is visible without testing it
+enum Visibility
+{
+    OUTSIDE,
+    INTERSECTING,
+    INSIDE
+};
+
+//what the camera can see this frame: the six planes of the view and the fog distance
+//past the fog distance (measured flat, like the fog in mainlit.fs) nothing shows through the fog
+class Frustum
+{
+    public:
+
+    //planes of the view projection matrix, viewPos in world space
+    void set(const glm::mat4& viewProjection, glm::vec3 viewPos, float fogDistance);
+
+    Visibility test(const BoundingBox& box) const;
+    bool test(const Bounds& sphere, bool fog = true) const;
+
+    //test count spheres, visible[i] is set to 1 or 0
+    //spheres go through sse four at a time, fog false skips the fog test (for things the fog doesn't hide)
+    void test(const Bounds* spheres, int count, uint8_t* visible, bool fog = true) const;
+
+    private:
+
+    //xyz normal pointing inside, w distance, normalized
+    glm::vec4 planes[6];
+
+    glm::vec3 viewPos;
+    float fogDistance;
+};
+
+//frustum, fog and horizon culling of a frame, split between worker threads
+//systems test their whole hierarchy through it and only queue the draws that survive
+//the horizon hides nothing until the terrain builds it (see Terrain::submit), what is tested after that is occlusion culled too
+class Culler
+{
+    public:
+
+    //the blocks run on pool, shared with the other systems of the frame
+    Culler(WorkerPool& pool);
+
+    //view of the frame, fogDistance is the view distance of the fog, clears the horizon
+    void begin(const glm::mat4& view, const glm::mat4& projection, glm::vec3 viewPos, float fogDistance);
+
+    const Frustum& getFrustum();
+    HorizonBuffer& getHorizon();
+
+    //test spheres against the view then the horizon, in blocks on the workers
+    void test(const Bounds* spheres, int count, uint8_t* visible, bool fog = true);
+    //same, visible is resized to match
+    void test(const std::vector<Bounds>& spheres, std::vector<uint8_t>& visible, bool fog = true);
+
+    //run job(i) for every i in [0, count) on the workers
+    void parallelFor(int count, const std::function<void(int)>& job);
+
+    private:
+
+    Frustum frustum;
+    HorizonBuffer horizon;
+    WorkerPool& pool;
+
+    //test a block of spheres on the calling thread
+    void testBlock(const Bounds* spheres, int count, uint8_t* visible, bool fog);
+};
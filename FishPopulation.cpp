@@ -0,0 +1,107 @@
+#include "FishPopulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+FishPopulation::FishPopulation(FishSchool* school, float worldSize, uint64_t seed) : school(school), seed(seed), worldSize(worldSize)
+{
+	Config config("res/config/Fish.config");
+
+	int totalFish = config.getConfig()->getInt("totalFish");
+	regionSize = config.getConfig()->getFloat("regionSize");
+	streamRadius = config.getConfig()->getFloat("streamRadius");
+
+	regions = std::max(1, (int)std::ceil(worldSize / regionSize));
+	grid.resize(regions * regions);
+
+	// Spread the fish over the regions, every region gets its own amount around the mean
+	float mean = float(totalFish) / grid.size();
+	for (int x = 0; x < regions; x++)
+	{
+		for (int z = 0; z < regions; z++)
+		{
+			Random random(Random::derive(seed, x, z));
+			grid[x * regions + z].count = int(mean * random.uniform(0.5f, 1.5f) + 0.5f);
+		}
+	}
+}
+
+int FishPopulation::regionOf(float value)
+{
+	int region = (int)std::floor(value / regionSize);
+	return std::min(std::max(region, 0), regions - 1);
+}
+
+bool FishPopulation::isNear(int x, int z, glm::vec3 position)
+{
+	// Distance on x/z to the closest point of the region
+	float closestX = std::min(std::max(position.x, x * regionSize), (x + 1) * regionSize);
+	float closestZ = std::min(std::max(position.z, z * regionSize), (z + 1) * regionSize);
+	float dx = position.x - closestX;
+	float dz = position.z - closestZ;
+	return dx * dx + dz * dz < streamRadius * streamRadius;
+}
+
+void FishPopulation::spawnRegion(int x, int z)
+{
+	Region& region = grid[x * regions + z];
+
+	Random random(Random::derive(seed, x, z, ++region.visits));
+	for (int i = 0; i < region.count; i++)
+	{
+		glm::vec3 position;
+		position.x = (x + random.uniform()) * regionSize;
+		position.y = random.uniform() * 80.0f + 15.0f;
+		position.z = (z + random.uniform()) * regionSize;
+		position.x = std::min(position.x, worldSize);
+		position.z = std::min(position.z, worldSize);
+		school->spawn(position, random.next64());
+	}
+
+	region.count = 0;
+	region.live = true;
+}
+
+void FishPopulation::update(glm::vec3 position)
+{
+	// Regions coming close get real fish, regions going away stop accepting them
+	for (int x = 0; x < regions; x++)
+	{
+		for (int z = 0; z < regions; z++)
+		{
+			bool near = isNear(x, z, position);
+			Region& region = grid[x * regions + z];
+			if (near && !region.live)
+			{
+				spawnRegion(x, z);
+			}
+			else if (!near && region.live)
+			{
+				region.live = false;
+			}
+		}
+	}
+
+	// Real fish in a far region go back to being a number
+	// Going backwards, despawning moves the last fish into the freed index
+	for (int i = school->size() - 1; i >= 0; i--)
+	{
+		glm::vec3 fishPosition = school->transforms[i].position;
+		Region& region = grid[regionOf(fishPosition.x) * regions + regionOf(fishPosition.z)];
+		if (!region.live && !school->states[i].held)
+		{
+			school->despawn(school->handleAt(i));
+			region.count++;
+		}
+	}
+}
+
+int FishPopulation::getTotal()
+{
+	int total = school->size();
+	for (auto& region : grid)
+	{
+		total += region.count;
+	}
+	return total;
+}
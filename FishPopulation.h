@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <GLM\glm.hpp>
+
+#include "FishSchool.h"
+#include "Config.h"
+#include "Random.h"
+
+// Streams the fish of the whole ocean in and out of a FishSchool around the camera
+// The ocean is split in square regions, far regions only keep how many fish they hold
+// Regions getting close spawn their fish into the school, fish swimming into a far
+// region are despawned and counted in it again, so the school only holds nearby fish
+class FishPopulation
+{
+public:
+
+	// Fish are spawned into school, seed is the fish stream of the world
+	FishPopulation(FishSchool* school, float worldSize, uint64_t seed);
+
+	// Spawn the fish of regions near the position and fold back the fish that are now far away
+	// position is in world space
+	void update(glm::vec3 position);
+
+	// Fish in the ocean, simulated or not
+	int getTotal();
+
+private:
+
+	// Statistical state of a region while it has no real fish
+	struct Region
+	{
+		// Fish the region holds while far, 0 while its fish are real
+		int count = 0;
+		// Times the region has been spawned, gives new fish on every visit
+		int visits = 0;
+		bool live = false;
+	};
+
+	FishSchool* school;
+	uint64_t seed;
+
+	float worldSize;
+	float regionSize;
+	float streamRadius;
+
+	// Regions on a side
+	int regions;
+	std::vector<Region> grid;
+
+	int regionOf(float value);
+	bool isNear(int x, int z, glm::vec3 position);
+	void spawnRegion(int x, int z);
+};
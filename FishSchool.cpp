@@ -0,0 +1,479 @@
+#include "FishSchool.h"
+#include "Terrain.h"
+
+#include <algorithm>
+#include <GLM\gtc\matrix_transform.hpp>
+
+Mesh FishSchool::mesh;
+
+// Fish per job of the worker pool
+static const int fishBlock = 256;
+
+const Mesh& FishSchool::getMesh()
+{
+	if (mesh.VAO == 0)
+	{
+		MeshArchive::load("fish", mesh);
+	}
+	return mesh;
+}
+
+SlotHandle FishSchool::spawn(glm::vec3 position, uint64_t seed)
+{
+	Transform transform;
+	Material material;
+	SwimParams swimParams;
+	SwimState state;
+	create(position, seed, transform, material, swimParams, state);
+
+	Bounds bound;
+	bound.center = position;
+	// The fish mesh fits in a 1 x 1 x 0.2 box
+	bound.radius = glm::length(transform.scale * glm::vec3(0.5f, 0.5f, 0.1f));
+
+	transforms.push_back(transform);
+	bounds.push_back(bound);
+	materials.push_back(material);
+	params.push_back(swimParams);
+	states.push_back(state);
+
+	return slots.insert();
+}
+
+void FishSchool::despawn(SlotHandle handle)
+{
+	int index = slots.erase(handle);
+	if (index < 0)
+	{
+		return;
+	}
+
+	swapRemove(transforms, index);
+	swapRemove(bounds, index);
+	swapRemove(materials, index);
+	swapRemove(params, index);
+	swapRemove(states, index);
+
+	// The last fish moved, the indices in the grid are wrong until it is rebuilt
+	broadphaseDirty = true;
+}
+
+bool FishSchool::isAlive(SlotHandle handle)
+{
+	return slots.contains(handle);
+}
+
+SlotHandle FishSchool::handleAt(int index)
+{
+	return slots.handleAt(index);
+}
+
+int FishSchool::size()
+{
+	return slots.size();
+}
+
+void FishSchool::create(glm::vec3 position, uint64_t seed, Transform& transform, Material& material, SwimParams& params, SwimState& state)
+{
+	// Random generator, same fish for the same seed
+	Random random(seed);
+
+	// Pseudorandomize animation and scale variables
+	float pRand = float(random.poisson(10)) / 10.0f;
+	float pRand2 = float(random.poisson(10)) / 8.0f;
+
+	glm::vec3 scale;
+	scale.x = pRand * random.uniform(1.0f, 3.0f) * 1.5;
+	scale.y = pRand * random.uniform(1.0f, 3.0f);
+	scale.z = pRand * random.uniform(1.0f, 3.0f) * 1.5;
+	scale *= pRand2;
+	params.velocity = pRand * random.uniform(1.0f, 3.0f) * 3.0f;
+	params.initYaw = random.uniform() * 360.0f;
+	params.oscRate = random.uniform(0.5f, 1.5f);
+	params.oscOffset = random.uniform() * 3.14159265;
+
+	transform.position = position;
+	transform.scale = scale;
+	transform.model = glm::translate(glm::mat4(1.0f), position);
+
+	// Update orientation vectors
+	state = SwimState();
+	updateVectors(state);
+
+	// Random colour
+	float baseColor = random.uniform(-0.1f, 0.1f);
+	glm::vec3 color;
+	color.x = random.uniform() + baseColor;
+	color.y = random.uniform() + baseColor;
+	color.z = random.uniform() + baseColor;
+
+	// Snapped to eighths, fish are respawned with new seeds every visit and each distinct colour stays in the palette
+	color = glm::round(color * 8.0f) / 8.0f;
+
+	// Assign material
+	material = Material(0.5f *color, 0.5f * color, glm::vec3(0.5f), 1.0f);
+}
+
+void FishSchool::animate(float deltaTime, Terrain* terrain, WorkerPool& pool)
+{
+	int count = size();
+
+	// Contiguous blocks of fish, one job each
+	pool.parallelFor((count + fishBlock - 1) / fishBlock, [this, deltaTime, terrain, count](int block)
+	{
+		animateRange(deltaTime, terrain, block * fishBlock, std::min(count, (block + 1) * fishBlock));
+	});
+
+	if (broadphase == nullptr)
+	{
+		float terrainSize = (terrain->getSize()) * (terrain->getPointsPerChunk() - 1);
+		broadphase = new SpatialGrid(terrainSize, 8.0f);
+	}
+	buildBroadphase();
+}
+
+void FishSchool::buildBroadphase()
+{
+	// Fish move every frame, so the grid is filled again rather than updated
+	broadphase->clear();
+	broadphaseDirty = false;
+	for (int i = 0; i < size(); i++)
+	{
+		if (states[i].held)
+		{
+			continue;
+		}
+
+		SpatialEntry entry;
+		entry.center = bounds[i].center;
+		entry.radius = bounds[i].radius;
+		entry.index = i;
+		broadphase->insert(entry);
+	}
+}
+
+bool FishSchool::sweep(glm::vec3 start, glm::vec3 end, float radius, float& t, SlotHandle& hit)
+{
+	t = 1.0f;
+	if (broadphase == nullptr)
+	{
+		return false;
+	}
+	if (broadphaseDirty)
+	{
+		buildBroadphase();
+	}
+
+	// Broadphase, fish whose bounding sphere is on the path
+	broadphase->sweepAll(start, end, radius, candidates);
+
+	bool found = false;
+	for (auto& candidate : candidates)
+	{
+		int i = candidate.index;
+
+		// Narrowphase, the path in the fish's space where its ellipsoid is a unit sphere
+		// The fish mesh fits in a 1 x 1 x 0.2 box
+		glm::vec3 axes = transforms[i].scale * glm::vec3(0.5f, 0.5f, 0.1f) + radius;
+		glm::mat4 toLocal = glm::inverse(transforms[i].model);
+		glm::vec3 localStart = glm::vec3(toLocal * glm::vec4(start, 1.0f)) / axes;
+		glm::vec3 localEnd = glm::vec3(toLocal * glm::vec4(end, 1.0f)) / axes;
+
+		// Solve |localStart + s * direction| = 1 for the first s
+		glm::vec3 direction = localEnd - localStart;
+		float a = glm::dot(direction, direction);
+		float b = glm::dot(localStart, direction);
+		float c = glm::dot(localStart, localStart) - 1.0f;
+
+		float s;
+		if (c < 0.0f)
+		{
+			s = 0.0f;
+		}
+		else
+		{
+			float discriminant = b * b - a * c;
+			if (a == 0.0f || b >= 0.0f || discriminant < 0.0f)
+			{
+				continue;
+			}
+			s = (-b - sqrt(discriminant)) / a;
+		}
+
+		if (s <= t)
+		{
+			t = s;
+			hit = slots.handleAt(i);
+			found = true;
+		}
+	}
+	return found;
+}
+
+void FishSchool::hold(SlotHandle handle)
+{
+	int index = slots.indexOf(handle);
+	if (index >= 0)
+	{
+		states[index].held = true;
+		broadphaseDirty = true;
+	}
+}
+
+void FishSchool::setModel(SlotHandle handle, const glm::mat4& model)
+{
+	int index = slots.indexOf(handle);
+	if (index < 0)
+	{
+		return;
+	}
+
+	transforms[index].model = model;
+	transforms[index].position = glm::vec3(model[3]);
+	bounds[index].center = transforms[index].position;
+}
+
+glm::mat4 FishSchool::getModel(SlotHandle handle)
+{
+	int index = slots.indexOf(handle);
+	return index < 0 ? glm::mat4(1.0f) : transforms[index].model;
+}
+
+void FishSchool::animateRange(float deltaTime, Terrain* terrain, int start, int end)
+{
+	for (int i = start; i < end; i++)
+	{
+		if (states[i].held)
+		{
+			continue;
+		}
+		swim(deltaTime, terrain, transforms[i], params[i], states[i]);
+		bounds[i].center = transforms[i].position;
+	}
+}
+
+void FishSchool::swim(float deltaTime, Terrain* terrain, Transform& transform, const SwimParams& params, SwimState& state)
+{
+	state.totalTime += deltaTime;
+
+	// Short swimming yaw oscillation
+	float yawOsc = sin((state.totalTime*2.5 + params.oscOffset)*params.oscRate) * 25.0f;
+
+	// Long trajectory yaw oscillation
+	float yawDir = 180 * sin((state.totalTime*0.1 + params.oscOffset)*params.oscRate) + params.initYaw;
+
+	state.yawTotal = yawOsc + yawDir + state.yawTurn1 + state.yawTurn2;
+
+	float pitchOsc = sin((state.totalTime + params.oscOffset)*params.oscRate) * 20.0f;
+
+
+	// Short pitch oscillation
+	state.pitch = pitchOsc + state.pitchTotal;
+	updateVectors(state);
+
+	glm::vec3& position = transform.position;
+	position += state.front * params.velocity * deltaTime;
+
+	// Drift with the ocean current
+	position += terrain->getCurrent()->sample(position) * deltaTime;
+
+	// Model transformations, scale is applied by the caller
+	glm::mat4 tempModel = glm::translate(glm::mat4(1.0f), position);
+
+	tempModel = glm::rotate(tempModel, glm::radians(-state.yawTotal), glm::vec3(0.0f, 1.0f, 0.0f));
+	tempModel = glm::rotate(tempModel, glm::radians(state.pitch), glm::vec3(0.0f, 0.0f, 1.0f));
+
+
+	float terrainSize = (terrain->getSize()) * (terrain->getPointsPerChunk() - 1);
+
+
+
+	if (state.belowTerrain && !state.turnedAround)
+	{
+		state.yawTurn1 += 3.0f;
+	}
+
+	if (state.yawTurn1 >= state.lastYawTotal + 180.0f)
+	{
+		state.turnedAround = true;
+	}
+
+
+	if (state.ascending && state.pitchTotal < 20.0f)
+	{
+		state.pitchTotal += 1.0f;
+	}
+
+	if (state.descending && state.pitchTotal > -20.0f)
+	{
+		state.pitchTotal -= 1.0f;
+	}
+
+	if (state.levelingOut)
+	{
+		if (state.pitchTotal > 0.0f)
+			state.pitchTotal -= 1.0f;
+		if (state.pitchTotal < 0.0f)
+			state.pitchTotal += 1.0f;
+		if (state.pitchTotal == 0.0f)
+			state.levelingOut = false;
+	}
+
+	float height = terrain->getHeightAt((int)position.x, (int)position.z);
+
+	// Below terrain
+	if ((position.y < (height + 6.0f)) && (state.belowTerrain == false))
+	{
+		state.belowTerrain = true;
+		state.descending = false;
+		state.ascending = true;
+		state.turnedAround = false;
+		state.lastYawTotal = state.yawTotal;
+	}
+
+	// Above terrain
+	if ((position.y > (height + 8.0f)) && (state.belowTerrain == true))
+	{
+		state.belowTerrain = false;
+		state.levelingOut = true;
+	}
+
+	// Above surface
+	if ((position.y > (height + 20.0f)) && (state.aboveSurface == false))
+	{
+		state.aboveSurface = true;
+		state.ascending = false;
+		state.descending = true;
+	}
+
+	// Below surface
+	if ((position.y < (height + 10.0f)) && (state.aboveSurface == true))
+	{
+		state.aboveSurface = false;
+		state.levelingOut = true;
+	}
+
+	// Outside terrain
+	if ((position.x < 0.0f || position.z < 0.0f || position.x > terrainSize || position.z > terrainSize) && (state.outsideTerrain == false))
+	{
+		state.outsideTerrain = true;
+		state.yawTurn2 += 180.0f;
+	}
+
+	// Inside terrain
+	if (!(position.x < 0.0f || position.z < 0.0f || position.x > terrainSize || position.z > terrainSize) && (state.outsideTerrain == true))
+	{
+		state.outsideTerrain = false;
+	}
+
+	transform.model = tempModel;
+}
+
+void FishSchool::updateVectors(SwimState& state)
+{
+	// Same as LearnOpenGL camera
+	glm::vec3 tempFront;
+	tempFront.x = cos(glm::radians(-state.yawTotal)) * cos(glm::radians(state.pitch));
+	tempFront.y = sin(glm::radians(state.pitch));
+	tempFront.z = sin(glm::radians(state.yawTotal)) * cos(glm::radians(state.pitch));
+
+	state.front = glm::normalize(tempFront);
+}
+
+void FishSchool::submit(RenderQueue& queue, Shader* shader, Culler& culler)
+{
+	int count = size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Every fish goes to the gpu, which drops the ones outside the view or lost in the fog
+	if (IndirectBatch::isEnabled())
+	{
+		instances.resize(count);
+		for (int i = 0; i < count; i++)
+		{
+			instances[i].model = transforms[i].model;
+			instances[i].scale = transforms[i].scale;
+			instances[i].material = materials[i].index;
+			instances[i].phase = 0.0f;
+		}
+
+		if (indirect == nullptr)
+		{
+			indirect = new IndirectBatch(&getMesh(), SWAY_NONE);
+			indirectRange = indirect->add(instances.data(), bounds.data(), count);
+		}
+		else
+		{
+			indirect->update(indirectRange, instances.data(), bounds.data(), count);
+		}
+		indirect->submit(queue, shader, materials[0].index, transforms[0].position);
+		return;
+	}
+
+	if (VAO == 0)
+	{
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+
+		glBindVertexArray(VAO);
+
+		// Shared mesh, one vertex per draw vertex
+		getMesh().bindAttributes();
+
+		// Instance data, one element per fish
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		ChunkBatch::bindInstanceAttributes();
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+	}
+
+	// Fish outside the view or lost in the fog are left out
+	culler.test(bounds, visible);
+
+	// Gather the components the shader needs
+	instances.clear();
+	int first = -1;
+	for (int i = 0; i < count; i++)
+	{
+		if (!visible[i])
+		{
+			continue;
+		}
+		if (first < 0)
+		{
+			first = i;
+		}
+
+		BatchInstance instance;
+		instance.model = transforms[i].model;
+		instance.scale = transforms[i].scale;
+		instance.material = materials[i].index;
+		instance.phase = 0.0f;
+		instances.push_back(instance);
+	}
+
+	int visibleCount = instances.size();
+	if (visibleCount == 0)
+	{
+		return;
+	}
+
+	// Orphan last frame's buffer instead of waiting for the gpu to finish with it
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(BatchInstance) * visibleCount, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(BatchInstance) * visibleCount, instances.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// The school is spread around, sort it from the first visible fish
+	DrawPacket packet;
+	packet.shader = shader;
+	packet.VAO = VAO;
+	packet.count = getMesh().vertexCount;
+	packet.instances = visibleCount;
+	packet.apply = ChunkBatch::applyInstances;
+	queue.submit(PASS_OPAQUE, packet, materials[first].index, transforms[first].position);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "SlotMap.h"
+#include "Components.h"
+#include "Material.h"
+#include "MeshArchive.h"
+#include "ChunkBatch.h"
+#include "Shader.h"
+#include "Random.h"
+#include "SpatialGrid.h"
+#include "Culling.h"
+#include "IndirectBatch.h"
+#include "WorkerPool.h"
+
+class Terrain;
+
+// Constant swimming parameters of a fish, drawn from its seed
+struct SwimParams
+{
+	GLfloat velocity;
+	GLfloat initYaw;
+	GLfloat oscOffset;
+	GLfloat oscRate;
+};
+
+// Swimming state of a fish, changed every update
+struct SwimState
+{
+	glm::vec3 front;
+
+	GLfloat totalTime = 0.0f;
+
+	// Euler angles
+	GLfloat yawTotal = 0.0f;
+	GLfloat yawTurn1 = 0.0f;
+	GLfloat yawTurn2 = 0.0f;
+	GLfloat pitch = 0.0f;
+	GLfloat pitchTotal = 0.0f;
+	GLfloat lastYawTotal = 0.0f;
+
+	bool aboveSurface = false;
+	bool belowTerrain = false;
+	bool turnedAround = false;
+	bool ascending = false;
+	bool descending = false;
+	bool levelingOut = false;
+	bool outsideTerrain = false;
+
+	// Held by a harpoon, moved by setModel instead of swimming
+	bool held = false;
+};
+
+// All the regular fish of the world, stored as packed component arrays
+// Fish are addressed by handles, spawn and despawn are O(1) and every fish is
+// updated and drawn by one call per frame instead of one virtual call per fish
+class FishSchool
+{
+public:
+
+	// Add a fish, the same seed always gives the same fish
+	SlotHandle spawn(glm::vec3 position, uint64_t seed);
+	// Remove a fish, stale handles are ignored
+	void despawn(SlotHandle handle);
+	bool isAlive(SlotHandle handle);
+	// Handle of the fish at an index of the packed arrays
+	SlotHandle handleAt(int index);
+
+	int size();
+
+	// Swim every fish, in blocks on pool
+	void animate(float deltaTime, Terrain* terrain, WorkerPool& pool);
+
+	// Send the fish the culler finds visible to the gpu and queue one instanced draw for all of them
+	// with IndirectBatch enabled every fish is sent and culled on the gpu instead
+	void submit(RenderQueue& queue, Shader* shader, Culler& culler);
+
+	// First fish a sphere moving from start to end passes through, fish are tested as ellipsoids
+	// t is set to the fraction of the path travelled before the hit, held fish are ignored
+	bool sweep(glm::vec3 start, glm::vec3 end, float radius, float& t, SlotHandle& hit);
+
+	// Stop a fish from swimming, it stays where setModel puts it
+	void hold(SlotHandle handle);
+	void setModel(SlotHandle handle, const glm::mat4& model);
+	glm::mat4 getModel(SlotHandle handle);
+
+	// Mesh shared by all fish, loaded from the mesh archive on first use
+	static const Mesh& getMesh();
+
+	// Components of a new fish, shared with the standalone Fish class
+	static void create(glm::vec3 position, uint64_t seed, Transform& transform, Material& material, SwimParams& params, SwimState& state);
+	// One swimming step of a fish
+	static void swim(float deltaTime, Terrain* terrain, Transform& transform, const SwimParams& params, SwimState& state);
+
+	// Packed components, index i of every array is the same fish
+	std::vector<Transform> transforms;
+	std::vector<Bounds> bounds;
+	std::vector<Material> materials;
+	std::vector<SwimParams> params;
+	std::vector<SwimState> states;
+
+private:
+
+	SlotMap slots;
+
+	// Bounding spheres of the free fish, rebuilt after every animate
+	SpatialGrid* broadphase = nullptr;
+	bool broadphaseDirty = false;
+	std::vector<SpatialEntry> candidates;
+
+	// Per instance data of the visible fish, rebuilt every frame
+	std::vector<BatchInstance> instances;
+	std::vector<uint8_t> visible;
+
+	GLuint VAO = 0;
+	GLuint VBO = 0;
+
+	// All fish in one range, when they are culled on the gpu
+	IndirectBatch* indirect = nullptr;
+	int indirectRange = -1;
+
+	static Mesh mesh;
+
+	void animateRange(float deltaTime, Terrain* terrain, int start, int end);
+	void buildBroadphase();
+	static void updateVectors(SwimState& state);
+};
@@ -0,0 +1,99 @@
+#include "FrameUniforms.h"
+
+#include <algorithm>
+#include <cstring>
+
+static_assert(sizeof(glm::vec3) == 12 && sizeof(glm::mat4) == 64, "std140 blocks expect tightly packed glm types");
+
+FrameUniforms::FrameUniforms()
+{
+    //zero the padding too, the blocks are compared byte by byte
+    std::memset(&frame, 0, sizeof(frame));
+    std::memset(&lights, 0, sizeof(lights));
+
+    glGenBuffers(1, &frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &lightsUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, lightsUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightsBlock), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, frameUBO);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BINDING, lightsUBO);
+}
+
+FrameUniforms::~FrameUniforms()
+{
+    glDeleteBuffers(1, &frameUBO);
+    glDeleteBuffers(1, &lightsUBO);
+}
+
+void FrameUniforms::attach(Shader* shader)
+{
+    GLuint frameIndex = glGetUniformBlockIndex(shader->program, "Frame");
+    if(frameIndex != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(shader->program, frameIndex, FRAME_BINDING);
+    }
+
+    GLuint lightsIndex = glGetUniformBlockIndex(shader->program, "Lights");
+    if(lightsIndex != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(shader->program, lightsIndex, LIGHTS_BINDING);
+    }
+}
+
+void FrameUniforms::setCamera(const glm::mat4& view, const glm::mat4& projection, glm::vec3 viewPos, float viewDistance, float time)
+{
+    FrameBlock block;
+    std::memset(&block, 0, sizeof(block));
+    block.view = view;
+    block.projection = projection;
+    block.viewPos = viewPos;
+    block.viewDistance = viewDistance;
+    block.time = time;
+
+    update(frameUBO, block, frame, frameKnown);
+}
+
+void FrameUniforms::setLights(const DirectionalLight& sun, const SpotLight& spotLight)
+{
+    LightsBlock block;
+    std::memset(&block, 0, sizeof(block));
+
+    block.dirLight.direction = sun.direction;
+    block.dirLight.ambient = sun.ambient;
+    block.dirLight.diffuse = sun.diffuse;
+    block.dirLight.specular = sun.specular;
+
+    block.spotLight.position = spotLight.position;
+    block.spotLight.direction = spotLight.direction;
+    block.spotLight.cutOff = spotLight.cutOff;
+    block.spotLight.outerCutOff = spotLight.outerCutOff;
+    block.spotLight.ambient = spotLight.ambient;
+    block.spotLight.diffuse = spotLight.diffuse;
+    block.spotLight.specular = spotLight.specular;
+    block.spotLight.constant = spotLight.constant;
+    block.spotLight.linear = spotLight.linear;
+    block.spotLight.quadratic = spotLight.quadratic;
+
+    update(lightsUBO, block, lights, lightsKnown);
+}
+
+template<typename T>
+void FrameUniforms::update(GLuint buffer, const T& data, T& current, bool& known)
+{
+    if(known && std::memcmp(&data, &current, sizeof(T)) == 0)
+    {
+        return;
+    }
+
+    current = data;
+    known = true;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &current);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "Shader.h"
+#include "DirectionalLight.h"
+#include "SpotLight.h"
+
+//camera and light data shared by every shader, kept in two std140 uniform buffers
+//shaders declare the blocks Frame and Lights (see mainlit.fs) and are attached once,
+//each buffer is rewritten at most once per frame and only when its content changed
+//point lights are too many for a block, they go through LightClusters
+class FrameUniforms
+{
+    public:
+
+    FrameUniforms();
+    ~FrameUniforms();
+
+    //bind the blocks the shader declares to the shared buffers, blocks it doesn't use are skipped
+    void attach(Shader* shader);
+
+    //viewPos in world space, time in seconds
+    void setCamera(const glm::mat4& view, const glm::mat4& projection, glm::vec3 viewPos, float viewDistance, float time);
+
+    void setLights(const DirectionalLight& sun, const SpotLight& spotLight);
+
+    private:
+
+    enum BlockBinding
+    {
+        FRAME_BINDING = 0,
+        LIGHTS_BINDING = 1
+    };
+
+    //the structs below follow the std140 layout of the blocks, vec3 take 16 bytes so a float fills the gap
+    struct FrameBlock
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 viewPos;
+        float viewDistance;
+        float time;
+        float padding[3];
+    };
+
+    struct DirLightBlock
+    {
+        glm::vec3 direction;
+        float padding0;
+        glm::vec3 ambient;
+        float padding1;
+        glm::vec3 diffuse;
+        float padding2;
+        glm::vec3 specular;
+        float padding3;
+    };
+
+    struct SpotLightBlock
+    {
+        glm::vec3 position;
+        float cutOff;
+        glm::vec3 direction;
+        float outerCutOff;
+        glm::vec3 ambient;
+        float constant;
+        glm::vec3 diffuse;
+        float linear;
+        glm::vec3 specular;
+        float quadratic;
+    };
+
+    struct LightsBlock
+    {
+        DirLightBlock dirLight;
+        SpotLightBlock spotLight;
+    };
+
+    //content of the buffers, compared against the new data before uploading
+    FrameBlock frame;
+    LightsBlock lights;
+    bool frameKnown = false;
+    bool lightsKnown = false;
+
+    GLuint frameUBO = 0;
+    GLuint lightsUBO = 0;
+
+    //upload data to buffer if it differs from what the buffer holds
+    template<typename T>
+    static void update(GLuint buffer, const T& data, T& current, bool& known);
+};
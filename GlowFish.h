@@ -9,9 +9,8 @@
 class GlowFish : public Fish, public PointLight
 {
 public:
-	GlowFish(glm::vec3 position);
+	GlowFish(glm::vec3 position, uint64_t seed);
 	~GlowFish();
-	void render(Shader* shader);
 	glm::vec3 getPosition();
 };
 
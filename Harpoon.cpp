@@ -1,11 +1,14 @@
-#pragma once
-
 #include "Harpoon.h"
-#include <GLM\glm.hpp>
-#include <GLM/gtc/matrix_transform.hpp>
+#include <GLM\gtc\matrix_transform.hpp>
+
+const float HarpoonPool::maxFlightTime = 10.0f;
+const float HarpoonPool::maxStuckTime = 20.0f;
+const float HarpoonPool::length = 12.0f;
+const float HarpoonPool::radius = 0.2f;
 
+Mesh HarpoonPool::mesh;
 
-glm::vec3 Harpoon::calculateNormal(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3)
+glm::vec3 HarpoonPool::calculateNormal(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3)
 {
     // Edge1, Edge2
     glm::vec3 e1, e2;
@@ -21,8 +24,12 @@ glm::vec3 Harpoon::calculateNormal(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3)
     return normal;
 }
 
-Harpoon::Harpoon(glm::vec3 position, glm::vec3 cameraFront) : position(-position), front(-cameraFront)
+const Mesh& HarpoonPool::getMesh()
 {
+    if (mesh.VBO != 0)
+    {
+        return mesh;
+    }
     
     glm::vec3 harpoonVertices[] = {
         // face 1
@@ -68,7 +75,7 @@ Harpoon::Harpoon(glm::vec3 position, glm::vec3 cameraFront) : position(-position
     
     // set vertices and normals for each side
     int surface = 0;
-    vertices = {
+    std::vector<glm::vec3> vertices = {
         // face 1
         harpoonVertices[0], surfaceNormals[surface],
         harpoonVertices[2], surfaceNormals[surface],
@@ -179,110 +186,61 @@ Harpoon::Harpoon(glm::vec3 position, glm::vec3 cameraFront) : position(-position
         harpoonVertices[17], surfaceNormals[surface],
     };
     
-    // Generate buffers
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    // Generate buffers, the geometry only lives on the gpu
+    glGenBuffers(1, &mesh.VBO);
     
-    // Buffer object data
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
-    
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-    
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-    
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
     
+    // Position and normal interleaved
+    mesh.vertexCount = vertices.size() / 2;
     
+    return mesh;
+}
+
+HarpoonPool::HarpoonPool(FishSchool* school, ParticleSystem* particles) : school(school), particles(particles)
+{
     // Apply material properties
     material = Material(glm::vec3(0.2), glm::vec3(0.5),glm::vec3(0.5), 0.7);
 }
 
-//bool Harpoon::load()
-//{
-//    if (VAO == 0)
-//    {
-//        
-//        return true;
-//    }
-//    return false;
-//}
-//
-//void Harpoon::unload()
-//{
-//    glDeleteBuffers(1, &VBO);
-//    glDeleteVertexArrays(1, &VAO);
-//    
-//    VBO = 0;
-//    VAO = 0;
-//}
-
-
-void Harpoon::render(Shader * shader)
+int HarpoonPool::size()
 {
-    // set normal matrix
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse(model));
-    
-    
-    // Broadcast the uniform values to the shaders
-    
-    GLint matAmbientLoc = glGetUniformLocation(shader->program, "material.ambient");
-    GLint matDiffuseLoc = glGetUniformLocation(shader->program, "material.diffuse");
-    GLint matSpecularLoc = glGetUniformLocation(shader->program, "material.specular");
-    GLint matShineLoc = glGetUniformLocation(shader->program, "material.shininess");
-    GLuint modelLoc = glGetUniformLocation(shader->program, "model");
-    GLint normalMatrixLoc = glGetUniformLocation(shader->program, "normalMatrix");
-    
-    glUniform3f(matAmbientLoc, material.ambient.x, material.ambient.y, material.ambient.z);
-    glUniform3f(matDiffuseLoc, material.diffuse.x, material.diffuse.y, material.diffuse.z);
-    glUniform3f(matSpecularLoc, material.specular.x, material.specular.y, material.specular.z);
-    glUniform1f(matShineLoc, material.shininess);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-    
-    
-    //GLuint viewLoc = glGetUniformLocation(shader->program, "view");
-    //GLuint projectionLoc = glGetUniformLocation(shader->program, "projection");
-    
-    
-    //glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    //glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    
-    // Draw object
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 96);
-    glBindVertexArray(0);
+    return count;
 }
 
-// animate the harpoon over time to move it through the scene
-void Harpoon::animate(float deltaTime, Terrain * terrain)
+void HarpoonPool::fire(glm::vec3 position, glm::vec3 cameraFront)
 {
-	// detect collision
-    glm::vec3 checkPosition = position + front * velocity * deltaTime;
-    if (!(terrain->isPositionValid(checkPosition)) && (isStuck == false))
+    // Every slot taken, reuse the oldest harpoon
+    if (count == capacity)
     {
-        isStuck = true;
+        int oldest = 0;
+        for (int i = 1; i < count; i++)
+        {
+            if (harpoons[i].age > harpoons[oldest].age)
+            {
+                oldest = i;
+            }
+        }
+        expire(oldest);
     }
     
-	// get terrain size to test bounds
-	float terrainSize = (terrain->getSize()) * (terrain->getPointsPerChunk() - 1);
+    Harpoon& harpoon = harpoons[count++];
+    harpoon = Harpoon();
+    harpoon.position = -position;
+    harpoon.front = -cameraFront;
+    harpoon.model = orient(harpoon.position, harpoon.front);
+}
 
-	// if the harpoon is shot out of the world
-	if (position.x < 5.0f || position.z < 5.0f || position.x > terrainSize-5.0 || position.z > terrainSize-5.0)
-	{
-		isOutside = true;
-		return;
-	}
-    // if the harpoon is stuck stop animating
-	else if (isStuck)
-		return;
-    
+void HarpoonPool::expire(int index)
+{
+    school->despawn(harpoons[index].caught);
+    harpoons[index] = harpoons[--count];
+}
+
+glm::mat4 HarpoonPool::orient(glm::vec3 position, glm::vec3 front)
+{
     // Calculate model rotation to match front vector
     glm::vec3 initial = glm::vec3(1.0f, 0.0f, 0.0f);
     glm::vec3 axis = glm::normalize(glm::cross(front, initial));
@@ -294,19 +252,145 @@ void Harpoon::animate(float deltaTime, Terrain * terrain)
         -axis.y, axis.x, 0.0f, 0.0f,
         0.0f, 0.0f, 0.0f, 0.0f
     };
-    rotationMatrix = glm::mat4(1.0f) + sin(angle) * a + (1 - cos(angle)) * (a * a);
+    glm::mat4 rotationMatrix = glm::mat4(1.0f) + sin(angle) * a + (1 - cos(angle)) * (a * a);
+    
+    // Model transformations
+    return glm::translate(glm::mat4(1.0f), position) * rotationMatrix;
+}
+
+// animate the harpoons over time to move them through the scene
+void HarpoonPool::animate(float deltaTime, Terrain * terrain)
+{
+    // get terrain size to test bounds
+    float terrainSize = (terrain->getSize()) * (terrain->getPointsPerChunk() - 1);
+    
+    int i = 0;
+    while (i < count)
+    {
+        Harpoon& harpoon = harpoons[i];
+        harpoon.age += deltaTime;
+        
+        // stuck harpoons stay where they are until they expire
+        if (harpoon.stuckTime >= 0.0f)
+        {
+            harpoon.stuckTime += deltaTime;
+            if (harpoon.stuckTime > maxStuckTime)
+            {
+                expire(i);
+                continue;
+            }
+            i++;
+            continue;
+        }
+        
+        // if the harpoon is shot out of the world or flew too long
+        glm::vec3& position = harpoon.position;
+        if (harpoon.age > maxFlightTime || position.x < 5.0f || position.z < 5.0f || position.x > terrainSize - 5.0f || position.z > terrainSize - 5.0f)
+        {
+            expire(i);
+            continue;
+        }
+        
+        harpoon.front.y = harpoon.front.y - 0.002f;
+        
+        // the current pushes the harpoon a little
+        // sweep the tip along the whole step, stop where it first touches something
+        glm::vec3 step = (harpoon.front * harpoon.velocity + terrain->getCurrent()->sample(position)) * deltaTime;
+        glm::vec3 tip = position + glm::normalize(harpoon.front) * length;
+        float t;
+        bool stuck = terrain->sweep(tip, tip + step, radius, t);
+        
+        // spear the first fish met before the harpoon stops
+        float fishT;
+        SlotHandle fish;
+        if (!school->isAlive(harpoon.caught) && school->sweep(tip, tip + step * t, radius, fishT, fish))
+        {
+            glm::mat4 contact = orient(position + step * t * fishT, harpoon.front);
+            harpoon.caught = fish;
+            harpoon.caughtOffset = glm::inverse(contact) * school->getModel(fish);
+            school->hold(fish);
+        }
+        
+        position += step * t;
+        if (stuck)
+        {
+            harpoon.stuckTime = 0.0f;
+            particles->emitSilt(tip + step * t);
+        }
+        else
+        {
+            particles->emitBubbles(position, deltaTime);
+        }
+        
+        harpoon.model = orient(position, harpoon.front);
+        
+        // the speared fish moves with the harpoon
+        school->setModel(harpoon.caught, harpoon.model * harpoon.caughtOffset);
+        i++;
+    }
+}
+
+void HarpoonPool::submit(RenderQueue& queue, Shader * shader, Culler& culler)
+{
+    if (count == 0)
+    {
+        return;
+    }
     
-    front.y = front.y - 0.002f;
+    if (VAO == 0)
+    {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        
+        glBindVertexArray(VAO);
+        
+        // Shared mesh
+        getMesh().bindAttributes();
+        
+        // Instance data, room for every slot so the buffer never grows
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(instances), NULL, GL_DYNAMIC_DRAW);
+        ChunkBatch::bindInstanceAttributes();
+        
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
     
-    // update position
-    position += front * velocity * deltaTime;
+    //sphere around the shaft, from its back end to its tip
+    for (int i = 0; i < count; i++)
+    {
+        bounds[i].center = harpoons[i].position + glm::normalize(harpoons[i].front) * (length * 0.5f);
+        bounds[i].radius = length * 0.5f + radius;
+    }
+    culler.test(bounds, count, visible);
     
-    // Model transformations
-    glm::mat4 tempModel = glm::translate(glm::mat4(1.0f), position);
+    int visibleCount = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (visible[i])
+        {
+            BatchInstance& instance = instances[visibleCount++];
+            instance.model = harpoons[i].model;
+            instance.scale = glm::vec3(1.0f);
+            instance.material = material.index;
+            instance.phase = 0.0f;
+        }
+    }
+    if (visibleCount == 0)
+    {
+        return;
+    }
     
-    // update tempModel with rotation matrix
-    tempModel = tempModel * rotationMatrix;
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(BatchInstance) * visibleCount, instances);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-    // set new model
-    model = tempModel;
+    //the harpoons are spread around, sort them from the first visible one
+    DrawPacket packet;
+    packet.shader = shader;
+    packet.VAO = VAO;
+    packet.count = getMesh().vertexCount;
+    packet.instances = visibleCount;
+    packet.apply = ChunkBatch::applyInstances;
+    queue.submit(PASS_OPAQUE, packet, material.index, glm::vec3(instances[0].model[3]));
 }
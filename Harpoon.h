@@ -1,52 +1,105 @@
 #pragma once
 
-//#include <GLM\gtc\type_ptr.hpp>
-#include "Renderable.h"
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
 #include "Terrain.h"
-#include "Camera.h"
+#include "FishSchool.h"
+#include "ParticleSystem.h"
+#include "Material.h"
+#include "MeshArchive.h"
+#include "ChunkBatch.h"
+#include "Shader.h"
+
+//one harpoon in flight or stuck in something
+struct Harpoon
+{
+    //back end of the shaft, the tip is length units along front
+    glm::vec3 position;
+    glm::vec3 front;
+
+    //movement speed
+    float velocity = 60.0f;
+
+    glm::mat4 model;
 
+    //seconds since the harpoon was fired
+    float age = 0.0f;
+    //seconds since it got stuck, negative while flying
+    float stuckTime = -1.0f;
 
+    //fish speared on the harpoon, and where it sits relative to the harpoon
+    SlotHandle caught;
+    glm::mat4 caughtOffset;
+};
 
-class Harpoon : public Renderable
+//every harpoon of the scene, stored in a fixed number of slots
+//all harpoons share one mesh and are drawn with one instanced draw,
+//expired harpoons give their slot back and firing with every slot taken reuses the oldest one
+class HarpoonPool
 {
     public:
-    
-	Harpoon(glm::vec3 position, glm::vec3 cameraFront);
-	~Harpoon() {};
 
-    glm::vec3 calculateNormal(glm::vec3 point1, glm::vec3 point2, glm::vec3 point3);
-    
-    void render(Shader* shader);
-    
-    void animate(float deltaTime, Terrain * terrain);
-    
-    /*bool load();
-    void unload();*/
-   
-	// test if the harpoon is outside of the terrain
-	bool isOutside = false;
-   
+    //most harpoons alive at once
+    static const int capacity = 64;
+    //flying harpoons are dropped after this many seconds
+    static const float maxFlightTime;
+    //stuck harpoons are dropped after this many seconds
+    static const float maxStuckTime;
 
-protected:
+    //length of the shaft and radius used for collisions
+    static const float length;
+    static const float radius;
 
-	// determine whether harpoon is stuck or not
-	bool isStuck = false;
+    //fish hit by harpoons are taken out of the school
+    //flying harpoons trail bubbles and throw up silt where they hit
+    HarpoonPool(FishSchool* school, ParticleSystem* particles);
 
+    //fire a harpoon, position and front are camera space (negated world space) like the camera's
+    void fire(glm::vec3 position, glm::vec3 cameraFront);
 
-	// Harpoon movement speed
-	GLfloat velocity = 60.0f;
+    //move the harpoons, the tip sweeps the path of the step against the terrain and its entities
+    //so fast harpoons can't pass through rocks between two frames
+    //a harpoon spears the first fish on its path and carries it until it expires
+    void animate(float deltaTime, Terrain* terrain);
+
+    //send the harpoons the culler finds visible to the gpu and queue one instanced draw for all of them
+    void submit(RenderQueue& queue, Shader* shader, Culler& culler);
+
+    int size();
+
+    private:
+
+    //live harpoons are packed at the front of the array
+    Harpoon harpoons[capacity];
+    int count = 0;
+
+    Material material;
+
+    FishSchool* school;
+    ParticleSystem* particles;
+
+    //per instance data of the visible harpoons
+    BatchInstance instances[capacity];
+    
+    //sphere around every shaft and whether it is visible, one slot per harpoon
+    Bounds bounds[capacity];
+    uint8_t visible[capacity];
 
+    GLuint VAO = 0;
+    GLuint VBO = 0;
 
-	// Position and orientation	
-	glm::vec3 position;
-	glm::vec3 front;
-	glm::vec3 up;
-	glm::vec3 right;
-	glm::mat4 rotationMatrix;
+    static Mesh mesh;
 
+    //build the shared mesh on first use, it has no VAO of its own
+    static const Mesh& getMesh();
 
-	// Variables for periodic animations
-	GLfloat totalTime;
+    //free a slot, the last live harpoon takes its place, its fish goes with it
+    void expire(int index);
 
+    //rotation and translation of a harpoon from its position and front
+    static glm::mat4 orient(glm::vec3 position, glm::vec3 front);
 
-};
\ No newline at end of file
+    static glm::vec3 calculateNormal(glm::vec3 point1, glm::vec3 point2, glm::vec3 point3);
+};
@@ -0,0 +1,186 @@
+#include "Horizon.h"
+#include "Culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const float pi = 3.14159265f;
+static const float binWidth = 2.0f * pi / HorizonBuffer::bins;
+//slope of a direction nothing hides
+static const float openSlope = -1e30f;
+
+void HorizonBuffer::clear()
+{
+    occluders.clear();
+    layerCount = 0;
+}
+
+void HorizonBuffer::begin(glm::vec3 eye, float cellSize)
+{
+    clear();
+    this->eye = eye;
+    this->cellSize = cellSize;
+    eyeCellX = (int)std::floor(eye.x / cellSize);
+    eyeCellZ = (int)std::floor(eye.z / cellSize);
+}
+
+void HorizonBuffer::addOccluder(glm::vec2 min, glm::vec2 max, float height)
+{
+    Occluder occluder;
+    occluder.min = min;
+    occluder.max = max;
+    occluder.height = height;
+
+    //the whole block has to be nearer than what it hides
+    int nearestRing;
+    rings(min, max, nearestRing, occluder.ring);
+    occluders.push_back(occluder);
+}
+
+void HorizonBuffer::build()
+{
+    int ringCount = 0;
+    for(auto& occluder : occluders)
+    {
+        ringCount = std::max(ringCount, occluder.ring + 1);
+    }
+
+    //blocks by ring, each ring only raises the horizon of the rings after it
+    std::sort(occluders.begin(), occluders.end(), [](const Occluder& a, const Occluder& b)
+    {
+        return a.ring < b.ring;
+    });
+
+    layerCount = ringCount + 1;
+    layers.resize(layerCount * bins);
+    std::fill(layers.begin(), layers.begin() + bins, openSlope);
+
+    int next = 0;
+    for(int ring = 0; ring < ringCount; ring++)
+    {
+        float* previous = &layers[ring * bins];
+        float* layer = &layers[(ring + 1) * bins];
+        std::copy(previous, previous + bins, layer);
+
+        for(; next < occluders.size() && occluders[next].ring == ring; next++)
+        {
+            const Occluder& occluder = occluders[next];
+            float from, to, nearest, furthest;
+            if(!span(occluder.min, occluder.max, from, to, nearest, furthest))
+            {
+                continue;
+            }
+
+            //lowest slope a ray can have and still pass under the top of the block,
+            //whichever direction of the block it takes
+            float rise = occluder.height - eye.y;
+            float slope = rise / (rise >= 0.0f ? furthest : nearest);
+
+            //only the directions fully inside the block
+            int first = (int)std::ceil(from / binWidth);
+            int last = (int)std::floor(to / binWidth) - 1;
+            for(int bin = first; bin <= last; bin++)
+            {
+                float& horizon = layer[(bin % bins + bins) % bins];
+                horizon = std::max(horizon, slope);
+            }
+        }
+    }
+}
+
+bool HorizonBuffer::isOccluded(const BoundingBox& box) const
+{
+    if(layerCount == 0 || box.isEmpty())
+    {
+        return false;
+    }
+
+    glm::vec2 min(box.min.x, box.min.z);
+    glm::vec2 max(box.max.x, box.max.z);
+    float from, to, nearest, furthest;
+    if(!span(min, max, from, to, nearest, furthest))
+    {
+        return false;
+    }
+
+    //steepest ray from the eye to any point of the box
+    float rise = box.max.y - eye.y;
+    float slope = rise / (rise >= 0.0f ? nearest : furthest);
+
+    //horizon of the blocks nearer than the box
+    int nearestRing, furthestRing;
+    rings(min, max, nearestRing, furthestRing);
+    const float* layer = &layers[std::min(nearestRing, layerCount - 1) * bins];
+
+    int first = (int)std::floor(from / binWidth);
+    int last = (int)std::floor(to / binWidth);
+    for(int bin = first; bin <= last; bin++)
+    {
+        if(slope >= layer[(bin % bins + bins) % bins])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HorizonBuffer::isOccluded(const Bounds& sphere) const
+{
+    BoundingBox box;
+    box.add(sphere);
+    return isOccluded(box);
+}
+
+void HorizonBuffer::rings(glm::vec2 min, glm::vec2 max, int& nearestRing, int& furthestRing) const
+{
+    int minX = (int)std::floor(min.x / cellSize) - eyeCellX;
+    int maxX = (int)std::floor(max.x / cellSize) - eyeCellX;
+    int minZ = (int)std::floor(min.y / cellSize) - eyeCellZ;
+    int maxZ = (int)std::floor(max.y / cellSize) - eyeCellZ;
+
+    //distance in cells along each axis, 0 when the range covers the eye's cell
+    int nearestX = minX > 0 ? minX : (maxX < 0 ? -maxX : 0);
+    int nearestZ = minZ > 0 ? minZ : (maxZ < 0 ? -maxZ : 0);
+    nearestRing = std::max(nearestX, nearestZ);
+    furthestRing = std::max(std::max(std::abs(minX), std::abs(maxX)), std::max(std::abs(minZ), std::abs(maxZ)));
+}
+
+bool HorizonBuffer::span(glm::vec2 min, glm::vec2 max, float& from, float& to, float& nearest, float& furthest) const
+{
+    glm::vec2 view(eye.x, eye.z);
+    glm::vec2 closest = glm::clamp(view, min, max) - view;
+    nearest = std::sqrt(glm::dot(closest, closest));
+    if(nearest < 1e-3f)
+    {
+        return false;
+    }
+
+    glm::vec2 reach = glm::max(glm::abs(min - view), glm::abs(max - view));
+    furthest = std::sqrt(glm::dot(reach, reach));
+
+    //directions of the corners around the middle one, a rectangle not around the eye covers less than half a turn
+    glm::vec2 middle = (min + max) * 0.5f - view;
+    float center = std::atan2(middle.y, middle.x);
+    glm::vec2 corners[4] = { min, glm::vec2(max.x, min.y), glm::vec2(min.x, max.y), max };
+    float low = 0.0f, high = 0.0f;
+    for(auto& corner : corners)
+    {
+        glm::vec2 offset = corner - view;
+        float angle = std::atan2(offset.y, offset.x) - center;
+        if(angle > pi)
+        {
+            angle -= 2.0f * pi;
+        }
+        else if(angle < -pi)
+        {
+            angle += 2.0f * pi;
+        }
+        low = std::min(low, angle);
+        high = std::max(high, angle);
+    }
+
+    //shifted so bin k starts at k * binWidth
+    from = center + low + pi;
+    to = center + high + pi;
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <GLM\glm.hpp>
+
+#include "Components.h"
+
+struct BoundingBox;
+
+//occlusion by the terrain, things hidden behind ridges and in valleys are rejected without drawing anything
+//around the eye, every direction (azimuth bin) keeps the steepest slope up to which the ground hides what is behind it
+//the ground is added as solid blocks of a grid under the terrain's lowest point in each cell
+//a block only hides things strictly further out in the grid (by rings of cells around the eye),
+//so the horizon is kept once per ring and objects are tested against the one of the ring they start in
+//working in azimuth and slope rather than screen columns keeps the test exact whatever the camera pitch
+class HorizonBuffer
+{
+    public:
+
+    //directions around the eye
+    static const int bins = 2048;
+
+    //hide nothing until the next build
+    void clear();
+
+    //start collecting blocks for an eye in world space, cellSize is the grid the rings are counted in
+    void begin(glm::vec3 eye, float cellSize);
+
+    //solid ground up to height over a rectangle of the xz plane, blocks around the eye are ignored
+    void addOccluder(glm::vec2 min, glm::vec2 max, float height);
+
+    //build the horizons of every ring from the blocks added since begin
+    void build();
+
+    //true if the whole box or sphere is behind the ground built so far
+    bool isOccluded(const BoundingBox& box) const;
+    bool isOccluded(const Bounds& sphere) const;
+
+    private:
+
+    struct Occluder
+    {
+        glm::vec2 min;
+        glm::vec2 max;
+        float height;
+        int ring;
+    };
+
+    std::vector<Occluder> occluders;
+
+    glm::vec3 eye;
+    float cellSize = 1.0f;
+    //cell of the grid the eye is in
+    int eyeCellX = 0, eyeCellZ = 0;
+
+    //horizon of ring r is layer r, built from the blocks of the rings before it
+    //no layers while nothing is built
+    std::vector<float> layers;
+    int layerCount = 0;
+
+    //smallest and largest ring of the cells a rectangle touches
+    void rings(glm::vec2 min, glm::vec2 max, int& nearestRing, int& furthestRing) const;
+
+    //directions a rectangle covers and its closest and furthest flat distance from the eye
+    //false if it contains the eye
+    bool span(glm::vec2 min, glm::vec2 max, float& from, float& to, float& nearest, float& furthest) const;
+};
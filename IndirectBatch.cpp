@@ -0,0 +1,300 @@
+#include "IndirectBatch.h"
+
+#include <algorithm>
+
+bool IndirectBatch::enabled = false;
+Shader* IndirectBatch::cullShader = nullptr;
+Uniform<int> IndirectBatch::slotCountUniform("slotCount");
+Uniform<int> IndirectBatch::instanceWordsUniform("instanceWords");
+std::vector<IndirectBatch*> IndirectBatch::batches;
+
+//slot no range draws from
+static const GLuint noRange = 0xffffffff;
+//invocations per work group, matches local_size_x in cull.cs
+static const GLuint groupSize = 64;
+
+//cull.cs copies instances as words
+static_assert(sizeof(BatchInstance) % sizeof(GLuint) == 0, "a BatchInstance is copied as whole words");
+static_assert(sizeof(Bounds) == 4 * sizeof(float), "a Bounds is read as a vec4");
+
+IndirectBatch::IndirectBatch(const Mesh* mesh, int swayType) : mesh(mesh), swayType(swayType)
+{
+}
+
+IndirectBatch::~IndirectBatch()
+{
+    GLuint buffers[] = { sourceBuffer, boundsBuffer, rangeBuffer, visibleBuffer, commandBuffer };
+    glDeleteBuffers(5, buffers);
+    glDeleteVertexArrays(1, &VAO);
+}
+
+int IndirectBatch::add(const BatchInstance* instances, const Bounds* bounds, int count)
+{
+    int id;
+    if(!freeRanges.empty())
+    {
+        id = freeRanges.back();
+        freeRanges.pop_back();
+    }
+    else
+    {
+        id = ranges.size();
+        ranges.push_back(Range());
+    }
+
+    Range& range = ranges[id];
+    range.used = true;
+    place(range, count);
+    write(id, instances, bounds, count);
+    return id;
+}
+
+void IndirectBatch::update(int id, const BatchInstance* instances, const Bounds* bounds, int count)
+{
+    Range& range = ranges[id];
+    if((GLuint)count > range.room)
+    {
+        //leave the old slots behind, with room to grow so a slowly growing owner doesn't move every frame
+        std::fill(rangeOf.begin() + range.start, rangeOf.begin() + range.start + range.room, noRange);
+        markDirty(range.start, range.start + range.room);
+        live -= range.room;
+        place(range, count + count / 2);
+    }
+    write(id, instances, bounds, count);
+}
+
+void IndirectBatch::remove(int id)
+{
+    Range& range = ranges[id];
+    std::fill(rangeOf.begin() + range.start, rangeOf.begin() + range.start + range.room, noRange);
+    markDirty(range.start, range.start + range.room);
+    live -= range.room;
+
+    range = Range();
+    freeRanges.push_back(id);
+}
+
+void IndirectBatch::place(Range& range, GLuint count)
+{
+    range.start = instances.size();
+    range.room = count;
+    range.count = 0;
+
+    GLuint end = range.start + count;
+    instances.resize(end);
+    bounds.resize(end);
+    rangeOf.resize(end, noRange);
+    live += count;
+}
+
+void IndirectBatch::write(int id, const BatchInstance* instances, const Bounds* bounds, int count)
+{
+    Range& range = ranges[id];
+    range.count = count;
+
+    std::copy(instances, instances + count, this->instances.begin() + range.start);
+    std::copy(bounds, bounds + count, this->bounds.begin() + range.start);
+    std::fill(rangeOf.begin() + range.start, rangeOf.begin() + range.start + count, (GLuint)id);
+    std::fill(rangeOf.begin() + range.start + count, rangeOf.begin() + range.start + range.room, noRange);
+    markDirty(range.start, range.start + range.room);
+}
+
+void IndirectBatch::markDirty(GLuint from, GLuint to)
+{
+    if(dirtyFrom >= dirtyTo)
+    {
+        dirtyFrom = from;
+        dirtyTo = to;
+        return;
+    }
+    dirtyFrom = std::min(dirtyFrom, from);
+    dirtyTo = std::max(dirtyTo, to);
+}
+
+void IndirectBatch::pack()
+{
+    GLuint slots = instances.size();
+    if(slots - live <= live)
+    {
+        return;
+    }
+
+    //ranges keep their room, only the holes between them go
+    std::vector<BatchInstance> packedInstances(live);
+    std::vector<Bounds> packedBounds(live);
+    std::vector<GLuint> packedRangeOf(live, noRange);
+    GLuint next = 0;
+    for(int id = 0; id < ranges.size(); id++)
+    {
+        Range& range = ranges[id];
+        if(!range.used)
+        {
+            continue;
+        }
+
+        std::copy(instances.begin() + range.start, instances.begin() + range.start + range.count, packedInstances.begin() + next);
+        std::copy(bounds.begin() + range.start, bounds.begin() + range.start + range.count, packedBounds.begin() + next);
+        std::fill(packedRangeOf.begin() + next, packedRangeOf.begin() + next + range.count, (GLuint)id);
+        range.start = next;
+        next += range.room;
+    }
+
+    instances.swap(packedInstances);
+    bounds.swap(packedBounds);
+    rangeOf.swap(packedRangeOf);
+    dirtyFrom = 0;
+    dirtyTo = live;
+}
+
+void IndirectBatch::upload()
+{
+    GLuint slots = instances.size();
+    if(slots > capacity)
+    {
+        if(VAO == 0)
+        {
+            glGenBuffers(1, &sourceBuffer);
+            glGenBuffers(1, &boundsBuffer);
+            glGenBuffers(1, &rangeBuffer);
+            glGenBuffers(1, &visibleBuffer);
+            glGenBuffers(1, &commandBuffer);
+
+            //renewing the storage of the buffers below keeps the vertex array pointing at them
+            glGenVertexArrays(1, &VAO);
+            glBindVertexArray(VAO);
+
+            // Shared mesh, one vertex per draw vertex
+            mesh->bindAttributes();
+
+            // Instances that passed the culling, one element per instance
+            glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+            ChunkBatch::bindInstanceAttributes();
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+        }
+
+        capacity = std::max(slots + slots / 2, groupSize);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sourceBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(BatchInstance) * capacity, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Bounds) * capacity, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, rangeBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * capacity, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(BatchInstance) * capacity, NULL, GL_DYNAMIC_COPY);
+
+        dirtyFrom = 0;
+        dirtyTo = slots;
+    }
+
+    if(dirtyFrom < dirtyTo)
+    {
+        GLuint count = dirtyTo - dirtyFrom;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sourceBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(BatchInstance) * dirtyFrom, sizeof(BatchInstance) * count, &instances[dirtyFrom]);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(Bounds) * dirtyFrom, sizeof(Bounds) * count, &bounds[dirtyFrom]);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, rangeBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * dirtyFrom, sizeof(GLuint) * count, &rangeOf[dirtyFrom]);
+    }
+    dirtyFrom = 0;
+    dirtyTo = 0;
+
+    //every command starts the frame with no instances, the culling pass counts them
+    commands.resize(ranges.size());
+    for(int id = 0; id < ranges.size(); id++)
+    {
+        const Range& range = ranges[id];
+        commands[id].count = range.used ? mesh->vertexCount : 0;
+        commands[id].instanceCount = 0;
+        commands[id].first = 0;
+        commands[id].baseInstance = range.start;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawCommand) * commands.size(), commands.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void IndirectBatch::submit(RenderQueue& queue, Shader* shader, uint16_t material, glm::vec3 center)
+{
+    if(live == 0)
+    {
+        return;
+    }
+
+    pack();
+    upload();
+
+    GLuint slots = instances.size();
+    cullShader->use();
+    cullShader->set(slotCountUniform, (int)slots);
+    cullShader->set(instanceWordsUniform, (int)(sizeof(BatchInstance) / sizeof(GLuint)));
+
+    // Buffer bindings of cull.cs
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, boundsBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, rangeBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, sourceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, visibleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, commandBuffer);
+
+    glDispatchCompute((slots + groupSize - 1) / groupSize, 1, 1);
+
+    //the draws read the instances and commands the pass writes
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    DrawPacket packet;
+    packet.shader = shader;
+    packet.VAO = VAO;
+    packet.count = commands.size();
+    packet.indirect = commandBuffer;
+    packet.apply = applyIndirect;
+    packet.owner = this;
+    queue.submit(PASS_OPAQUE, packet, material, center);
+}
+
+bool IndirectBatch::isSupported()
+{
+    //the 3.3 core context asked for in main comes back as the newest core version the driver has (4.5 on llvmpipe)
+    return GLEW_VERSION_4_3;
+}
+
+void IndirectBatch::enable(Shader* cullShader)
+{
+    IndirectBatch::cullShader = cullShader;
+    enabled = true;
+}
+
+bool IndirectBatch::isEnabled()
+{
+    return enabled;
+}
+
+IndirectBatch* IndirectBatch::shared(const Mesh* mesh, int swayType)
+{
+    for(auto batch : batches)
+    {
+        if(batch->mesh == mesh && batch->swayType == swayType)
+        {
+            return batch;
+        }
+    }
+
+    batches.push_back(new IndirectBatch(mesh, swayType));
+    return batches.back();
+}
+
+void IndirectBatch::submitShared(RenderQueue& queue, Shader* shader, glm::vec3 center)
+{
+    for(auto batch : batches)
+    {
+        batch->submit(queue, shader, 0, center);
+    }
+}
+
+void IndirectBatch::applyIndirect(Shader* shader, void* owner)
+{
+    IndirectBatch* batch = (IndirectBatch*)owner;
+    shader->set(ChunkBatch::batchModeUniform, 2);
+    shader->set(ChunkBatch::swayTypeUniform, batch->swayType);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "Shader.h"
+#include "Components.h"
+#include "MeshArchive.h"
+#include "ChunkBatch.h"
+#include "RenderQueue.h"
+
+//instances of one shared mesh culled on the gpu and drawn with one glMultiDrawArraysIndirect
+//every owner (an instance group of a chunk, the fish school) keeps a range of the instance buffer and one draw command
+//each frame cull.cs tests every bounding sphere against the view and the fog and packs the instances that pass
+//at the start of their range, counting them in the range's command, so the cpu never walks the instances
+//needs gl 4.3 (compute shaders, storage buffers, indirect draws with a base instance), see isSupported
+class IndirectBatch
+{
+    public:
+
+    IndirectBatch(const Mesh* mesh, int swayType);
+    ~IndirectBatch();
+
+    //take a range for count instances and their bounding spheres, returns its id
+    int add(const BatchInstance* instances, const Bounds* bounds, int count);
+    //replace the instances of a range, the range moves to the end of the buffer when it outgrows its room
+    void update(int range, const BatchInstance* instances, const Bounds* bounds, int count);
+    //free a range, its room is reclaimed when the buffer gets packed
+    void remove(int range);
+
+    //cull every instance on the gpu and queue the multi draw, center is where the draw is sorted from
+    //the Frame block has to hold this frame's camera
+    void submit(RenderQueue& queue, Shader* shader, uint16_t material, glm::vec3 center);
+
+    //true if the context can run the path, needs a call to glewInit first
+    static bool isSupported();
+    //use the path from now on, cullShader is cull.cs and has to be attached to the FrameUniforms
+    static void enable(Shader* cullShader);
+    static bool isEnabled();
+
+    //batch shared by every chunk drawing mesh with swayType, created on first use
+    static IndirectBatch* shared(const Mesh* mesh, int swayType);
+    //cull and queue the shared batches
+    static void submitShared(RenderQueue& queue, Shader* shader, glm::vec3 center);
+
+    private:
+
+    //layout of a command read by glMultiDrawArraysIndirect
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint first;
+        GLuint baseInstance;
+    };
+
+    //instances [start, start + count) of the buffers, with room for more up to start + room
+    struct Range
+    {
+        GLuint start = 0;
+        GLuint count = 0;
+        GLuint room = 0;
+        bool used = false;
+    };
+
+    const Mesh* mesh;
+    int swayType;
+
+    //cpu copies, one element per slot of the instance buffer
+    //rangeOf is the range owning the slot, or noRange for slots nothing is drawn from
+    std::vector<BatchInstance> instances;
+    std::vector<Bounds> bounds;
+    std::vector<GLuint> rangeOf;
+
+    std::vector<Range> ranges;
+    std::vector<int> freeRanges;
+    std::vector<DrawCommand> commands;
+
+    //slots taken by used ranges, the rest up to instances.size() is waiting to be packed away
+    GLuint live = 0;
+
+    //slots changed since the last upload
+    GLuint dirtyFrom = 0;
+    GLuint dirtyTo = 0;
+
+    //slots the gpu buffers were created for
+    GLuint capacity = 0;
+
+    //source instances, spheres, ranges of the slots, instances that passed and their draw commands
+    GLuint sourceBuffer = 0;
+    GLuint boundsBuffer = 0;
+    GLuint rangeBuffer = 0;
+    GLuint visibleBuffer = 0;
+    GLuint commandBuffer = 0;
+    //mesh attributes and the instances that passed
+    GLuint VAO = 0;
+
+    static bool enabled;
+    static Shader* cullShader;
+    static Uniform<int> slotCountUniform;
+    static Uniform<int> instanceWordsUniform;
+    static std::vector<IndirectBatch*> batches;
+
+    //give a range room for count instances at the end of the buffer
+    void place(Range& range, GLuint count);
+    //fill the start of a range, the rest of its room draws nothing
+    void write(int id, const BatchInstance* instances, const Bounds* bounds, int count);
+    void markDirty(GLuint from, GLuint to);
+    //move the used ranges next to each other when more than half of the buffer is unused
+    void pack();
+    //send the changed slots, growing the gpu buffers if needed
+    void upload();
+
+    static void applyIndirect(Shader* shader, void* owner);
+};
@@ -0,0 +1,274 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+Uniform<int> LightClusters::lightUnitUniform("pointLightData");
+Uniform<int> LightClusters::rangeUnitUniform("clusterRanges");
+Uniform<int> LightClusters::indexUnitUniform("clusterLights");
+Uniform<glm::ivec3> LightClusters::countUniform("clusterCount");
+Uniform<glm::vec2> LightClusters::tileSizeUniform("clusterTileSize");
+Uniform<float> LightClusters::nearUniform("clusterNear");
+Uniform<float> LightClusters::sliceScaleUniform("clusterSliceScale");
+
+//lights per job when computing their bounds
+static const int lightBlock = 256;
+
+LightClusters::LightClusters(ConfigSection* config, float cutoff, WorkerPool& pool) : cutoff(cutoff), pool(pool)
+{
+    tilesX = std::max(config->getInt("x"), 1);
+    tilesY = std::max(config->getInt("y"), 1);
+    slices = std::max(config->getInt("z"), 1);
+    nearDistance = std::max(config->getFloat("near"), 0.01f);
+    maxLightsPerCluster = std::max(config->getInt("maxLightsPerCluster"), 1);
+
+    sliceLists.resize(slices);
+    ranges.resize(tilesX * tilesY * slices);
+}
+
+LightClusters::~LightClusters()
+{
+    glDeleteTextures(1, &lightTexture);
+    glDeleteTextures(1, &rangeTexture);
+    glDeleteTextures(1, &indexTexture);
+    glDeleteBuffers(1, &lightBuffer);
+    glDeleteBuffers(1, &rangeBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+}
+
+float LightClusters::lightRadius(const PointLight& light, float cutoff)
+{
+    //brightest channel the light gives, attenuation 1 / (constant + linear d + quadratic d^2) brings it to cutoff at the radius
+    glm::vec3 peak = glm::max(light.ambient, glm::max(light.diffuse, light.specular));
+    float brightness = std::max(peak.x, std::max(peak.y, peak.z));
+    float target = brightness / cutoff;
+    if(light.constant >= target)
+    {
+        return 0.0f;
+    }
+
+    if(light.quadratic > 0.0f)
+    {
+        float a = light.quadratic;
+        float b = light.linear;
+        float c = light.constant - target;
+        return (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+    }
+    if(light.linear > 0.0f)
+    {
+        return (target - light.constant) / light.linear;
+    }
+
+    //never fades, reaches everything
+    return 1e30f;
+}
+
+int LightClusters::sliceAt(float depth)
+{
+    if(depth <= nearDistance)
+    {
+        return 0;
+    }
+    int slice = (int)(std::log(depth / nearDistance) * slices / std::log(farDistance / nearDistance));
+    return std::min(slice, slices - 1);
+}
+
+void LightClusters::update(const std::vector<GlowFish*>& lights, const glm::mat4& view, const glm::mat4& projection, float farDistance)
+{
+    this->farDistance = std::max(farDistance, nearDistance * 2.0f);
+
+    int count = lights.size();
+    lightTexels.resize(count * 4);
+    bounds.resize(count);
+
+    float scaleX = projection[0][0];
+    float scaleY = projection[1][1];
+
+    //light data and the clusters covered by each light's sphere
+    pool.parallelFor((count + lightBlock - 1) / lightBlock, [&](int block)
+    {
+        int end = std::min(count, (block + 1) * lightBlock);
+        for(int i = block * lightBlock; i < end; i++)
+        {
+            GlowFish* light = lights[i];
+            glm::vec3 position = light->getPosition();
+            float radius = lightRadius(*light, cutoff);
+
+            lightTexels[i * 4 + 0] = glm::vec4(position, radius);
+            lightTexels[i * 4 + 1] = glm::vec4(light->ambient, light->constant);
+            lightTexels[i * 4 + 2] = glm::vec4(light->diffuse, light->linear);
+            lightTexels[i * 4 + 3] = glm::vec4(light->specular, light->quadratic);
+
+            LightBounds& box = bounds[i];
+            //empty until proven visible
+            box.minZ = 1;
+            box.maxZ = 0;
+
+            glm::vec3 center = glm::vec3(view * glm::vec4(position, 1.0f));
+            float depth = -center.z;
+            float nearest = depth - radius;
+            float farthest = depth + radius;
+            if(radius <= 0.0f || farthest < 0.0f || nearest > this->farDistance)
+            {
+                continue;
+            }
+
+            //screen rectangle of the sphere's box, the whole screen when the box reaches behind the camera
+            float left = -1.0f, right = 1.0f, bottom = -1.0f, top = 1.0f;
+            if(nearest > 0.0f)
+            {
+                left = scaleX * (center.x - radius) / (center.x - radius < 0.0f ? nearest : farthest);
+                right = scaleX * (center.x + radius) / (center.x + radius > 0.0f ? nearest : farthest);
+                bottom = scaleY * (center.y - radius) / (center.y - radius < 0.0f ? nearest : farthest);
+                top = scaleY * (center.y + radius) / (center.y + radius > 0.0f ? nearest : farthest);
+            }
+            if(right < -1.0f || left > 1.0f || top < -1.0f || bottom > 1.0f)
+            {
+                continue;
+            }
+
+            box.minX = std::max(0, (int)std::floor((left * 0.5f + 0.5f) * tilesX));
+            box.maxX = std::min(tilesX - 1, (int)std::floor((right * 0.5f + 0.5f) * tilesX));
+            box.minY = std::max(0, (int)std::floor((bottom * 0.5f + 0.5f) * tilesY));
+            box.maxY = std::min(tilesY - 1, (int)std::floor((top * 0.5f + 0.5f) * tilesY));
+            box.minZ = sliceAt(nearest);
+            box.maxZ = sliceAt(farthest);
+        }
+    });
+
+    //every slice only writes its own lists
+    pool.parallelFor(slices, [this](int slice)
+    {
+        binSlice(slice);
+    });
+
+    //join the lists, cluster (x, y, slice) is at (slice * tilesY + y) * tilesX + x
+    int tiles = tilesX * tilesY;
+    indices.clear();
+    for(int slice = 0; slice < slices; slice++)
+    {
+        SliceLists& lists = sliceLists[slice];
+        uint32_t base = indices.size();
+        for(int tile = 0; tile < tiles; tile++)
+        {
+            ranges[slice * tiles + tile] = glm::uvec2(base + lists.starts[tile], lists.counts[tile]);
+        }
+        indices.insert(indices.end(), lists.indices.begin(), lists.indices.end());
+    }
+}
+
+void LightClusters::binSlice(int slice)
+{
+    SliceLists& lists = sliceLists[slice];
+    int tiles = tilesX * tilesY;
+    lists.counts.assign(tiles, 0);
+    lists.starts.resize(tiles);
+
+    //count, then fill, so every tile's lights are next to each other
+    int count = bounds.size();
+    for(int i = 0; i < count; i++)
+    {
+        const LightBounds& light = bounds[i];
+        if(slice < light.minZ || slice > light.maxZ)
+        {
+            continue;
+        }
+        for(int y = light.minY; y <= light.maxY; y++)
+        {
+            for(int x = light.minX; x <= light.maxX; x++)
+            {
+                lists.counts[y * tilesX + x]++;
+            }
+        }
+    }
+
+    uint32_t total = 0;
+    for(int tile = 0; tile < tiles; tile++)
+    {
+        lists.counts[tile] = std::min(lists.counts[tile], (uint32_t)maxLightsPerCluster);
+        lists.starts[tile] = total;
+        total += lists.counts[tile];
+    }
+    lists.indices.resize(total);
+
+    //starts move along as lights are written, filled tiles drop the rest
+    std::vector<uint32_t>& cursor = lists.cursor;
+    cursor = lists.starts;
+    for(int i = 0; i < count; i++)
+    {
+        const LightBounds& light = bounds[i];
+        if(slice < light.minZ || slice > light.maxZ)
+        {
+            continue;
+        }
+        for(int y = light.minY; y <= light.maxY; y++)
+        {
+            for(int x = light.minX; x <= light.maxX; x++)
+            {
+                int tile = y * tilesX + x;
+                if(cursor[tile] < lists.starts[tile] + lists.counts[tile])
+                {
+                    lists.indices[cursor[tile]++] = i;
+                }
+            }
+        }
+    }
+}
+
+void LightClusters::bind(Shader* shader, int width, int height)
+{
+    //texture buffers can't be empty, the shader never reads past the ranges anyway
+    if(lightTexels.empty())
+    {
+        lightTexels.resize(4);
+    }
+    if(indices.empty())
+    {
+        indices.push_back(0);
+    }
+
+    uploadBuffer(lightBuffer, lightTexture, GL_RGBA32F, lightTexels.data(), sizeof(glm::vec4) * lightTexels.size());
+    uploadBuffer(rangeBuffer, rangeTexture, GL_RG32UI, ranges.data(), sizeof(glm::uvec2) * ranges.size());
+    uploadBuffer(indexBuffer, indexTexture, GL_R32UI, indices.data(), sizeof(uint32_t) * indices.size());
+
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_BUFFER, lightTexture);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_BUFFER, rangeTexture);
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader->set(lightUnitUniform, 4);
+    shader->set(rangeUnitUniform, 5);
+    shader->set(indexUnitUniform, 6);
+    shader->set(countUniform, glm::ivec3(tilesX, tilesY, slices));
+    shader->set(tileSizeUniform, glm::vec2((float)width / tilesX, (float)height / tilesY));
+    shader->set(nearUniform, nearDistance);
+    shader->set(sliceScaleUniform, slices / std::log(farDistance / nearDistance));
+}
+
+int LightClusters::getIndexCount()
+{
+    return indices.size();
+}
+
+void LightClusters::uploadBuffer(GLuint& buffer, GLuint& texture, GLenum format, const void* data, size_t size)
+{
+    if(buffer == 0)
+    {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+
+        //the texture reads whatever storage the buffer has, renewing it below keeps the link
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
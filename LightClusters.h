@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "Config.h"
+#include "Shader.h"
+#include "GlowFish.h"
+#include "WorkerPool.h"
+
+//clustered forward lighting for the point lights (glowfish)
+//the view is split in screen tiles and exponential depth slices, every frame each light is binned into
+//the clusters its sphere touches, the radius being where its attenuation falls under the cutoff
+//the fragment shader only loops over the lights of its own cluster (see mainlit.fs)
+//slices are binned in parallel on a worker pool, the lists are sent to the gpu as texture buffers
+class LightClusters
+{
+    public:
+
+    //settings come from the clusters section of res/config/Lighting.config
+    //slices are binned on pool, shared with the other systems of the frame
+    LightClusters(ConfigSection* config, float cutoff, WorkerPool& pool);
+    ~LightClusters();
+
+    //distance at which a light's brightness falls to cutoff, 0 if it never reaches it
+    static float lightRadius(const PointLight& light, float cutoff);
+
+    //bin the lights for this view, farDistance is where the last slice ends
+    void update(const std::vector<GlowFish*>& lights, const glm::mat4& view, const glm::mat4& projection, float farDistance);
+
+    //send the lights and clusters to texture units 4 to 6 for the shader in use
+    //width and height are the framebuffer size in pixels
+    void bind(Shader* shader, int width, int height);
+
+    //lights binned in the last update, summed over every cluster
+    int getIndexCount();
+
+    private:
+
+    int tilesX, tilesY, slices;
+    float nearDistance;
+    float farDistance = 1.0f;
+    int maxLightsPerCluster;
+    float cutoff;
+
+    //per light, four texels: position and radius, ambient and constant, diffuse and linear, specular and quadratic
+    std::vector<glm::vec4> lightTexels;
+
+    //clusters each light touches, inclusive ranges
+    struct LightBounds
+    {
+        int minX, maxX;
+        int minY, maxY;
+        int minZ, maxZ;
+    };
+    std::vector<LightBounds> bounds;
+
+    //light indices of the clusters of one slice, filled by one worker
+    struct SliceLists
+    {
+        //per tile of the slice, where its lights start in indices and how many
+        std::vector<uint32_t> starts;
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> indices;
+        //next free index of every tile while filling
+        std::vector<uint32_t> cursor;
+    };
+    std::vector<SliceLists> sliceLists;
+
+    //per cluster: where its lights start in indices and how many there are
+    std::vector<glm::uvec2> ranges;
+    std::vector<uint32_t> indices;
+
+    WorkerPool& pool;
+
+    //buffers and the texture reading each of them
+    GLuint lightBuffer = 0, rangeBuffer = 0, indexBuffer = 0;
+    GLuint lightTexture = 0, rangeTexture = 0, indexTexture = 0;
+
+    static Uniform<int> lightUnitUniform;
+    static Uniform<int> rangeUnitUniform;
+    static Uniform<int> indexUnitUniform;
+    static Uniform<glm::ivec3> countUniform;
+    static Uniform<glm::vec2> tileSizeUniform;
+    static Uniform<float> nearUniform;
+    static Uniform<float> sliceScaleUniform;
+
+    //slice a view depth falls in, clamped to the grid
+    int sliceAt(float depth);
+
+    //fill the lists of one slice
+    void binSlice(int slice);
+
+    //replace the content of a texture buffer, the storage is renewed so the gpu never waits
+    static void uploadBuffer(GLuint& buffer, GLuint& texture, GLenum format, const void* data, size_t size);
+};
@@ -1,4 +1,9 @@
 #include "Material.h"
+#include "MaterialPalette.h"
+#include "Shader.h"
+
+// Handle shared by every object drawn with a material
+static Uniform<int> indexUniform("materialIndex");
 
 
 
@@ -8,6 +13,7 @@ Material::Material()
 	diffuse = glm::vec3(1.0f, 0.5f, 0.31f);
 	specular = glm::vec3(0.5f, 0.5f, 0.5f);
 	shininess = 32.0f;
+	index = MaterialPalette::add(ambient, diffuse, specular, shininess);
 }
 
 Material::Material(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular, float shininess)
@@ -16,9 +22,15 @@ Material::Material(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular, flo
 	this->diffuse = diffuse;
 	this->specular = specular;
 	this->shininess = shininess;
+	this->index = MaterialPalette::add(ambient, diffuse, specular, shininess);
 }
 
 
 Material::~Material()
 {
 }
+
+void Material::apply(Shader* shader) const
+{
+	shader->set(indexUniform, (int)index);
+}
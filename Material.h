@@ -1,15 +1,22 @@
 #pragma once
+#include <cstdint>
 #include <GLM/detail/type_vec3.hpp>
 
+class Shader;
+
 class Material
 {
 public:
 	Material();
 	Material(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular, float shininess);
 	~Material();
+	// Send the material's palette index to the shader in use (materialIndex)
+	void apply(Shader* shader) const;
 	glm::vec3 ambient;
 	glm::vec3 diffuse;
 	glm::vec3 specular;
 	float shininess;
+	// Entry of the material in the MaterialPalette, what the shader reads
+	uint16_t index;
 };
 
@@ -0,0 +1,135 @@
+#include "MaterialPalette.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//most entries a 16 bit index can reach
+static const int indexLimit = 65536;
+//texels of a texture buffer every 3.3 context supports
+static const int minimumTexels = 65536;
+
+int MaterialPalette::capacity = minimumTexels / 3;
+std::mutex MaterialPalette::mutex;
+std::map<MaterialPalette::Key, uint16_t> MaterialPalette::entries;
+std::vector<glm::vec4> MaterialPalette::texels;
+int MaterialPalette::uploaded = 0;
+GLuint MaterialPalette::buffer = 0;
+GLuint MaterialPalette::texture = 0;
+int MaterialPalette::bufferCapacity = 0;
+Uniform<int> MaterialPalette::paletteUniform("materialPalette");
+
+void MaterialPalette::init()
+{
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = std::min(indexLimit, std::max<int>(maxTexels, minimumTexels) / 3);
+}
+
+uint16_t MaterialPalette::add(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular, float shininess)
+{
+    float channels[10] = { ambient.x, ambient.y, ambient.z, diffuse.x, diffuse.y, diffuse.z, specular.x, specular.y, specular.z, shininess };
+    Key key;
+    for(int i = 0; i < 10; i++)
+    {
+        key[i] = (int32_t)std::lround(channels[i] * 256.0f);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    //entry 0 is kept for the fallback, taken before anything else
+    if(entries.empty())
+    {
+        Key grey = { 64, 64, 64, 128, 128, 128, 64, 64, 64, 256 };
+        insert(grey);
+    }
+
+    auto found = entries.find(key);
+    if(found != entries.end())
+    {
+        return found->second;
+    }
+
+    if(entries.size() >= capacity)
+    {
+        return fallback;
+    }
+
+    uint16_t index = insert(key);
+    if(entries.size() == capacity)
+    {
+        std::cout << "Material palette is full, new materials use the fallback entry" << std::endl;
+    }
+
+    return index;
+}
+
+void MaterialPalette::upload()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(uploaded == texels.size())
+    {
+        return;
+    }
+
+    if(buffer == 0)
+    {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+    }
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+
+    //grow the buffer by doubling, everything is sent again into the new storage
+    if(texels.size() > bufferCapacity)
+    {
+        bufferCapacity = std::max(bufferCapacity, 3 * 256);
+        while(bufferCapacity < texels.size())
+        {
+            bufferCapacity *= 2;
+        }
+        bufferCapacity = std::min(bufferCapacity, capacity * 3);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4) * bufferCapacity, NULL, GL_DYNAMIC_DRAW);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        uploaded = 0;
+    }
+
+    glBufferSubData(GL_TEXTURE_BUFFER, sizeof(glm::vec4) * uploaded, sizeof(glm::vec4) * (texels.size() - uploaded), texels.data() + uploaded);
+    uploaded = texels.size();
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void MaterialPalette::bind(Shader* shader)
+{
+    upload();
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader->set(paletteUniform, 3);
+}
+
+int MaterialPalette::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+uint16_t MaterialPalette::insert(const Key& key)
+{
+    //store the rounded material so every object matching the entry looks the same
+    uint16_t index = entries.size();
+    entries[key] = index;
+    texels.push_back(glm::vec4(key[0], key[1], key[2], 0) / 256.0f);
+    texels.push_back(glm::vec4(key[3], key[4], key[5], 0) / 256.0f);
+    texels.push_back(glm::vec4(key[6], key[7], key[8], key[9]) / 256.0f);
+    return index;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "Shader.h"
+
+//every distinct material in the world, stored once in a texture buffer the shader reads (materialPalette)
+//objects keep a 16 bit index instead of their colours, so batched and instanced draws
+//can mix entities of different materials
+//materials are matched after rounding to 1/256, entities regenerated from the same seed reuse their entry
+//entries are never freed, so materials drawn from continuous random colours have to be snapped to a few steps (see FishSchool::create)
+class MaterialPalette
+{
+    public:
+
+    //plain grey entry every material added once the palette is full gets
+    static const uint16_t fallback = 0;
+
+    //raise the capacity to what the context's texture buffers hold, needs the gl context
+    //until then the palette stays within the 65536 texels every 3.3 context has
+    static void init();
+
+    //index of the entry matching the material, added if there is none
+    //safe to call from the chunk threads, the gpu copy is only updated by upload
+    static uint16_t add(glm::vec3 ambient, glm::vec3 diffuse, glm::vec3 specular, float shininess);
+
+    //send the entries added since the last upload to the gpu
+    static void upload();
+
+    //upload, then bind the palette to texture unit 3 for the shader in use
+    static void bind(Shader* shader);
+
+    static int size();
+
+    private:
+
+    //rounded channels of an entry: ambient, diffuse, specular and shininess
+    typedef std::array<int32_t, 10> Key;
+
+    //entries that fit both a 16 bit index and the texture buffer, three texels each
+    static int capacity;
+
+    static std::mutex mutex;
+    static std::map<Key, uint16_t> entries;
+    //three per entry: ambient, diffuse, specular with the shininess in w
+    static std::vector<glm::vec4> texels;
+    //texels already on the gpu
+    static int uploaded;
+
+    static GLuint buffer;
+    static GLuint texture;
+    //texels the buffer has room for
+    static int bufferCapacity;
+
+    static Uniform<int> paletteUniform;
+
+    //add an entry, the mutex has to be held
+    static uint16_t insert(const Key& key);
+};
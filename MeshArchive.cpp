@@ -0,0 +1,240 @@
+#include "MeshArchive.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char* MeshArchive::data = nullptr;
+size_t MeshArchive::size = 0;
+void* MeshArchive::fileHandle = nullptr;
+void* MeshArchive::mappingHandle = nullptr;
+
+//convert an IEEE half float back to a float
+static float fromHalf(uint16_t half)
+{
+    uint32_t sign = uint32_t(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    float value;
+    if (exponent == 0)
+    {
+        //zero and denormals
+        value = std::ldexp(float(mantissa), -24);
+    }
+    else if (exponent == 31)
+    {
+        value = mantissa == 0 ? INFINITY : NAN;
+    }
+    else
+    {
+        value = std::ldexp(float(mantissa | 0x400), int(exponent) - 25);
+    }
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    bits |= sign;
+    std::memcpy(&value, &bits, sizeof(bits));
+    return value;
+}
+
+void Mesh::bindAttributes() const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+    if (format == MESH_FORMAT_QUANTIZED)
+    {
+        // Half float position, normal packed in one int
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, 12, (GLvoid*)0);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 12, (GLvoid*)8);
+    }
+    else
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+}
+
+bool MeshArchive::open(std::string path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        std::cout << "Could not open " << path << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const char* view = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr)
+    {
+        std::cout << "Could not map " << path << std::endl;
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = view;
+    size = (size_t)fileSize.QuadPart;
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        std::cout << "Could not open " << path << std::endl;
+        return false;
+    }
+
+    struct stat fileStat;
+    fstat(file, &fileStat);
+
+    void* view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (view == MAP_FAILED)
+    {
+        std::cout << "Could not map " << path << std::endl;
+        return false;
+    }
+
+    data = (const char*)view;
+    size = (size_t)fileStat.st_size;
+#endif
+
+    // Validate header and entry table once, load() trusts them afterwards
+    const MeshArchiveHeader* header = (const MeshArchiveHeader*)data;
+    bool valid = size >= sizeof(MeshArchiveHeader)
+        && std::memcmp(header->magic, MESH_ARCHIVE_MAGIC, sizeof(header->magic)) == 0
+        && header->version == MESH_ARCHIVE_VERSION
+        && header->entryOffset + (uint64_t)header->meshCount * sizeof(MeshArchiveEntry) <= size;
+
+    for (uint32_t i = 0; valid && i < header->meshCount; i++)
+    {
+        const MeshArchiveEntry& entry = ((const MeshArchiveEntry*)(data + header->entryOffset))[i];
+        valid = entry.dataOffset + entry.dataSize <= size && entry.dataOffset % MESH_ARCHIVE_ALIGNMENT == 0;
+
+        // Vertices are read with the stride of their format, all of them have to be in the entry's data
+        uint32_t stride = meshFormatStride(entry.format);
+        valid = valid && stride != 0 && entry.stride == stride
+            && (uint64_t)entry.vertexCount * stride <= entry.dataSize;
+    }
+
+    if (!valid)
+    {
+        std::cout << "Invalid mesh archive " << path << std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MeshArchive::close()
+{
+    if (data == nullptr)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+#else
+    munmap((void*)data, size);
+#endif
+
+    data = nullptr;
+    size = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+}
+
+const MeshArchiveEntry* MeshArchive::find(std::string name)
+{
+    if (data == nullptr)
+    {
+        return nullptr;
+    }
+
+    const MeshArchiveHeader* header = (const MeshArchiveHeader*)data;
+    const MeshArchiveEntry* entries = (const MeshArchiveEntry*)(data + header->entryOffset);
+
+    for (uint32_t i = 0; i < header->meshCount; i++)
+    {
+        if (strncmp(entries[i].name, name.c_str(), MESH_ARCHIVE_NAME_LENGTH) == 0)
+        {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+bool MeshArchive::load(std::string name, Mesh& mesh)
+{
+    const MeshArchiveEntry* entry = find(name);
+    if (entry == nullptr)
+    {
+        std::cout << "Mesh " << name << " not found in archive" << std::endl;
+        return false;
+    }
+
+    mesh.vertexCount = entry->vertexCount;
+    mesh.format = entry->format;
+
+    // Bounding box, read from the mapping like the upload
+    const char* vertex = data + entry->dataOffset;
+    for (uint32_t i = 0; i < entry->vertexCount; i++, vertex += entry->stride)
+    {
+        glm::vec3 position;
+        if (entry->format == MESH_FORMAT_QUANTIZED)
+        {
+            uint16_t half[3];
+            std::memcpy(half, vertex, sizeof(half));
+            position = glm::vec3(fromHalf(half[0]), fromHalf(half[1]), fromHalf(half[2]));
+        }
+        else
+        {
+            std::memcpy(&position, vertex, sizeof(position));
+        }
+
+        mesh.boundsMin = i == 0 ? position : glm::min(mesh.boundsMin, position);
+        mesh.boundsMax = i == 0 ? position : glm::max(mesh.boundsMax, position);
+    }
+
+    // Generate buffers
+    glGenVertexArrays(1, &mesh.VAO);
+    glGenBuffers(1, &mesh.VBO);
+
+    // Upload straight from the mapped file
+    glBindVertexArray(mesh.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glBufferData(GL_ARRAY_BUFFER, entry->dataSize, data + entry->dataOffset, GL_STATIC_DRAW);
+
+    mesh.bindAttributes();
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    return true;
+}
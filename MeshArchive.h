@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "MeshArchiveFormat.h"
+
+//gpu buffers of a mesh loaded from the archive
+struct Mesh
+{
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLsizei vertexCount = 0;
+    uint32_t format = MESH_FORMAT_FLOAT;
+
+    //bounding box of the vertex positions, in mesh space
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    //point position (0) and normal (1) attributes of the bound VAO at this mesh's buffer
+    void bindAttributes() const;
+};
+
+//read only view of a packed mesh archive (see MeshArchiveFormat.h)
+//the file is memory mapped, mesh data goes from the mapping straight to the gpu without parsing
+class MeshArchive
+{
+    public:
+
+    //map the archive, returns false if it is missing or not a valid archive
+    static bool open(std::string path);
+    //unmap the archive, meshes already loaded stay valid
+    static void close();
+
+    //create buffers for a mesh of the archive, returns false if there is no such mesh
+    static bool load(std::string name, Mesh& mesh);
+
+    private:
+
+    static const MeshArchiveEntry* find(std::string name);
+
+    //mapped file
+    static const char* data;
+    static size_t size;
+
+    //platform handles of the mapping
+    static void* fileHandle;
+    static void* mappingHandle;
+};
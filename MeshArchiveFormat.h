@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+//Layout of the binary mesh archive (.pak)
+//written offline by tools/MeshPacker.cpp and mapped at runtime by MeshArchive
+//
+//file:   MeshArchiveHeader, MeshArchiveEntry[meshCount], vertex data
+//all values are little endian, offsets are from the start of the file
+//vertex data of every mesh starts on a MESH_ARCHIVE_ALIGNMENT boundary so it can be
+//handed to glBufferData straight from the mapped file
+
+const char MESH_ARCHIVE_MAGIC[4] = { 'A', 'Q', 'M', 'A' };
+const uint32_t MESH_ARCHIVE_VERSION = 1;
+const uint32_t MESH_ARCHIVE_ALIGNMENT = 64;
+const uint32_t MESH_ARCHIVE_NAME_LENGTH = 48;
+
+//vertex layouts a mesh can be stored in
+enum MeshVertexFormat : uint32_t
+{
+    //float position xyz, float normal xyz (24 bytes)
+    MESH_FORMAT_FLOAT = 0,
+    //half float position xyz + padding, normal packed as signed 2_10_10_10 (12 bytes)
+    MESH_FORMAT_QUANTIZED = 1
+};
+
+//bytes per vertex of a format, 0 for formats this version doesn't know
+inline uint32_t meshFormatStride(uint32_t format)
+{
+    switch (format)
+    {
+    case MESH_FORMAT_FLOAT: return 24;
+    case MESH_FORMAT_QUANTIZED: return 12;
+    default: return 0;
+    }
+}
+
+struct MeshArchiveHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t meshCount;
+    //offset of the first MeshArchiveEntry
+    uint32_t entryOffset;
+};
+
+struct MeshArchiveEntry
+{
+    //zero terminated mesh name, ie "seaweed_green"
+    char name[MESH_ARCHIVE_NAME_LENGTH];
+    uint32_t format;
+    uint32_t vertexCount;
+    uint32_t stride;
+    uint32_t reserved;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+static_assert(sizeof(MeshArchiveHeader) == 16, "MeshArchiveHeader layout changed");
+static_assert(sizeof(MeshArchiveEntry) == 80, "MeshArchiveEntry layout changed");
@@ -0,0 +1,360 @@
+#include "OceanCurrent.h"
+#include "Terrain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+Uniform<int> OceanCurrent::fieldUniform("currentField");
+Uniform<float> OceanCurrent::inverseSizeUniform("currentInverseSize");
+Uniform<float> OceanCurrent::strengthUniform("currentStrength");
+
+OceanCurrent::OceanCurrent(float worldSize, ConfigSection* config, Terrain* terrain, WorkerPool& pool) : worldSize(worldSize), pool(pool)
+{
+    resolution = config->getInt("resolution");
+    resolution = (std::max(resolution, 1) + tileSize - 1) / tileSize * tileSize;
+    stride = resolution + 2;
+    tiles = resolution / tileSize;
+    cellSize = worldSize / resolution;
+
+    direction = glm::normalize(glm::vec3(config->getFloat("directionX"), 0.0f, config->getFloat("directionZ")));
+    strength = config->getFloat("strength");
+    relax = config->getFloat("relax");
+    viscosity = config->getFloat("viscosity");
+    diffuseIterations = config->getInt("diffuseIterations");
+    pressureIterations = config->getInt("pressureIterations");
+    drive = direction * strength;
+
+    int cells = stride * stride;
+    for(auto field : {&u, &v, &uPrevious, &vPrevious, &uNext, &vNext, &pressure, &pressureNext, &divergence, &openLeft, &openRight, &openDown, &openUp, &openInverse})
+    {
+        field->assign(cells, 0.0f);
+    }
+
+    //the ghost ring is open water, solid cells are where the terrain is above the obstacle height
+    float obstacleHeight = config->getFloat("obstacleHeight");
+    open.assign(cells, 1.0f);
+    for(int y = 0; y < resolution; y++)
+    {
+        for(int x = 0; x < resolution; x++)
+        {
+            float height = terrain->getHeightAt((x + 0.5f) * cellSize, (y + 0.5f) * cellSize);
+            open[index(x, y)] = height > obstacleHeight ? 0.0f : 1.0f;
+        }
+    }
+
+    for(int y = 0; y < resolution; y++)
+    {
+        for(int x = 0; x < resolution; x++)
+        {
+            int i = index(x, y);
+            openLeft[i] = open[i - 1];
+            openRight[i] = open[i + 1];
+            openDown[i] = open[i - stride];
+            openUp[i] = open[i + stride];
+
+            float neighbours = openLeft[i] + openRight[i] + openDown[i] + openUp[i];
+            openInverse[i] = open[i] > 0.0f && neighbours > 0.0f ? 1.0f / neighbours : 0.0f;
+
+            u[i] = drive.x * open[i];
+            v[i] = drive.z * open[i];
+        }
+    }
+    setGhosts(u, v);
+}
+
+int OceanCurrent::index(int x, int y)
+{
+    return (y + 1) * stride + x + 1;
+}
+
+void OceanCurrent::forEachTile(const std::function<void(int, int, int, int)>& kernel)
+{
+    pool.parallelFor(tiles * tiles, [this, &kernel](int tile)
+    {
+        int x0 = (tile % tiles) * tileSize;
+        int y0 = (tile / tiles) * tileSize;
+        kernel(x0, y0, x0 + tileSize, y0 + tileSize);
+    });
+}
+
+void OceanCurrent::setGhosts(std::vector<float>& x, std::vector<float>& z)
+{
+    for(int i = -1; i <= resolution; i++)
+    {
+        for(int ghost : {index(i, -1), index(i, resolution), index(-1, i), index(resolution, i)})
+        {
+            x[ghost] = drive.x;
+            z[ghost] = drive.z;
+        }
+    }
+}
+
+float OceanCurrent::interpolate(const std::vector<float>& field, float x, float y)
+{
+    //the ghost ring is part of the field
+    x = std::min(std::max(x, -1.0f), resolution - 0.001f);
+    y = std::min(std::max(y, -1.0f), resolution - 0.001f);
+
+    int x0 = (int)std::floor(x);
+    int y0 = (int)std::floor(y);
+    float fx = x - x0;
+    float fy = y - y0;
+
+    int i = index(x0, y0);
+    float bottom = field[i] + (field[i + 1] - field[i]) * fx;
+    float top = field[i + stride] + (field[i + stride + 1] - field[i + stride]) * fx;
+    return bottom + (top - bottom) * fy;
+}
+
+void OceanCurrent::simulate(float deltaTime)
+{
+    //long frames would carry the flow through walls
+    deltaTime = std::min(deltaTime, 1.0f / 20.0f);
+    time += deltaTime;
+
+    //the overall current comes in slow surges
+    drive = direction * strength * (0.75f + 0.25f * std::sin(time * 0.7f));
+
+    setGhosts(u, v);
+    setGhosts(uPrevious, vPrevious);
+    setGhosts(uNext, vNext);
+
+    force(deltaTime);
+    advect(deltaTime);
+    diffuse(deltaTime);
+    project();
+}
+
+void OceanCurrent::force(float deltaTime)
+{
+    __m128 pull = _mm_set1_ps(std::min(1.0f, relax * deltaTime));
+    __m128 driveX = _mm_set1_ps(drive.x);
+    __m128 driveZ = _mm_set1_ps(drive.z);
+
+    forEachTile([&](int x0, int y0, int x1, int y1)
+    {
+        for(int y = y0; y < y1; y++)
+        {
+            for(int x = x0; x < x1; x += 4)
+            {
+                int i = index(x, y);
+                __m128 water = _mm_loadu_ps(&open[i]);
+                __m128 uValue = _mm_loadu_ps(&u[i]);
+                __m128 vValue = _mm_loadu_ps(&v[i]);
+
+                //u += (drive - u) * pull, only in water
+                uValue = _mm_add_ps(uValue, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(driveX, uValue), pull), water));
+                vValue = _mm_add_ps(vValue, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(driveZ, vValue), pull), water));
+
+                _mm_storeu_ps(&u[i], uValue);
+                _mm_storeu_ps(&v[i], vValue);
+            }
+        }
+    });
+}
+
+void OceanCurrent::advect(float deltaTime)
+{
+    //semi lagrangian, every cell takes the velocity found where its flow comes from
+    std::swap(u, uPrevious);
+    std::swap(v, vPrevious);
+
+    float scale = deltaTime / cellSize;
+
+    //reads are scattered so this pass stays scalar
+    forEachTile([&](int x0, int y0, int x1, int y1)
+    {
+        for(int y = y0; y < y1; y++)
+        {
+            for(int x = x0; x < x1; x++)
+            {
+                int i = index(x, y);
+                if(open[i] == 0.0f)
+                {
+                    u[i] = 0.0f;
+                    v[i] = 0.0f;
+                    continue;
+                }
+
+                float fromX = x - uPrevious[i] * scale;
+                float fromY = y - vPrevious[i] * scale;
+                u[i] = interpolate(uPrevious, fromX, fromY);
+                v[i] = interpolate(vPrevious, fromX, fromY);
+            }
+        }
+    });
+}
+
+void OceanCurrent::diffuse(float deltaTime)
+{
+    float a = viscosity * deltaTime / (cellSize * cellSize);
+    if(a <= 0.0f || diffuseIterations <= 0)
+    {
+        return;
+    }
+
+    //jacobi on (1 + 4a) x - a * neighbours = advected, starting from the advected field
+    uPrevious = u;
+    vPrevious = v;
+
+    __m128 weight = _mm_set1_ps(a);
+    __m128 inverse = _mm_set1_ps(1.0f / (1.0f + 4.0f * a));
+
+    for(int iteration = 0; iteration < diffuseIterations; iteration++)
+    {
+        forEachTile([&](int x0, int y0, int x1, int y1)
+        {
+            for(int y = y0; y < y1; y++)
+            {
+                for(int x = x0; x < x1; x += 4)
+                {
+                    int i = index(x, y);
+                    __m128 water = _mm_loadu_ps(&open[i]);
+
+                    //solid cells hold no velocity so their neighbours read 0 from them
+                    __m128 uSum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&uPrevious[i - 1]), _mm_loadu_ps(&uPrevious[i + 1])),
+                                             _mm_add_ps(_mm_loadu_ps(&uPrevious[i - stride]), _mm_loadu_ps(&uPrevious[i + stride])));
+                    __m128 vSum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&vPrevious[i - 1]), _mm_loadu_ps(&vPrevious[i + 1])),
+                                             _mm_add_ps(_mm_loadu_ps(&vPrevious[i - stride]), _mm_loadu_ps(&vPrevious[i + stride])));
+
+                    __m128 uValue = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&u[i]), _mm_mul_ps(weight, uSum)), inverse);
+                    __m128 vValue = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&v[i]), _mm_mul_ps(weight, vSum)), inverse);
+
+                    _mm_storeu_ps(&uNext[i], _mm_mul_ps(uValue, water));
+                    _mm_storeu_ps(&vNext[i], _mm_mul_ps(vValue, water));
+                }
+            }
+        });
+        std::swap(uPrevious, uNext);
+        std::swap(vPrevious, vNext);
+    }
+
+    std::swap(u, uPrevious);
+    std::swap(v, vPrevious);
+}
+
+void OceanCurrent::project()
+{
+    __m128 half = _mm_set1_ps(0.5f / cellSize);
+    __m128 cellArea = _mm_set1_ps(cellSize * cellSize);
+    __m128 one = _mm_set1_ps(1.0f);
+
+    //divergence, solid neighbours hold no velocity so nothing flows through walls
+    forEachTile([&](int x0, int y0, int x1, int y1)
+    {
+        for(int y = y0; y < y1; y++)
+        {
+            for(int x = x0; x < x1; x += 4)
+            {
+                int i = index(x, y);
+                __m128 flowX = _mm_sub_ps(_mm_loadu_ps(&u[i + 1]), _mm_loadu_ps(&u[i - 1]));
+                __m128 flowZ = _mm_sub_ps(_mm_loadu_ps(&v[i + stride]), _mm_loadu_ps(&v[i - stride]));
+                _mm_storeu_ps(&divergence[i], _mm_mul_ps(_mm_add_ps(flowX, flowZ), half));
+            }
+        }
+    });
+
+    //jacobi on the pressure poisson equation, starting from last frame's pressure
+    //solid neighbours mirror the cell's own pressure, so they are left out of the average
+    for(int iteration = 0; iteration < pressureIterations; iteration++)
+    {
+        forEachTile([&](int x0, int y0, int x1, int y1)
+        {
+            for(int y = y0; y < y1; y++)
+            {
+                for(int x = x0; x < x1; x += 4)
+                {
+                    int i = index(x, y);
+                    __m128 sum = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&openLeft[i]), _mm_loadu_ps(&pressure[i - 1])),
+                                   _mm_mul_ps(_mm_loadu_ps(&openRight[i]), _mm_loadu_ps(&pressure[i + 1]))),
+                        _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&openDown[i]), _mm_loadu_ps(&pressure[i - stride])),
+                                   _mm_mul_ps(_mm_loadu_ps(&openUp[i]), _mm_loadu_ps(&pressure[i + stride]))));
+
+                    __m128 value = _mm_sub_ps(sum, _mm_mul_ps(_mm_loadu_ps(&divergence[i]), cellArea));
+                    _mm_storeu_ps(&pressureNext[i], _mm_mul_ps(value, _mm_loadu_ps(&openInverse[i])));
+                }
+            }
+        });
+        std::swap(pressure, pressureNext);
+    }
+
+    //remove the pressure gradient, what is left has no divergence
+    forEachTile([&](int x0, int y0, int x1, int y1)
+    {
+        for(int y = y0; y < y1; y++)
+        {
+            for(int x = x0; x < x1; x += 4)
+            {
+                int i = index(x, y);
+                __m128 center = _mm_loadu_ps(&pressure[i]);
+
+                //p = open ? neighbour : center
+                __m128 left = _mm_loadu_ps(&openLeft[i]);
+                __m128 right = _mm_loadu_ps(&openRight[i]);
+                __m128 down = _mm_loadu_ps(&openDown[i]);
+                __m128 up = _mm_loadu_ps(&openUp[i]);
+                __m128 pressureLeft = _mm_add_ps(_mm_mul_ps(left, _mm_loadu_ps(&pressure[i - 1])), _mm_mul_ps(_mm_sub_ps(one, left), center));
+                __m128 pressureRight = _mm_add_ps(_mm_mul_ps(right, _mm_loadu_ps(&pressure[i + 1])), _mm_mul_ps(_mm_sub_ps(one, right), center));
+                __m128 pressureDown = _mm_add_ps(_mm_mul_ps(down, _mm_loadu_ps(&pressure[i - stride])), _mm_mul_ps(_mm_sub_ps(one, down), center));
+                __m128 pressureUp = _mm_add_ps(_mm_mul_ps(up, _mm_loadu_ps(&pressure[i + stride])), _mm_mul_ps(_mm_sub_ps(one, up), center));
+
+                __m128 water = _mm_loadu_ps(&open[i]);
+                __m128 uValue = _mm_sub_ps(_mm_loadu_ps(&u[i]), _mm_mul_ps(_mm_sub_ps(pressureRight, pressureLeft), half));
+                __m128 vValue = _mm_sub_ps(_mm_loadu_ps(&v[i]), _mm_mul_ps(_mm_sub_ps(pressureUp, pressureDown), half));
+
+                _mm_storeu_ps(&uNext[i], _mm_mul_ps(uValue, water));
+                _mm_storeu_ps(&vNext[i], _mm_mul_ps(vValue, water));
+            }
+        }
+    });
+    std::swap(u, uNext);
+    std::swap(v, vNext);
+}
+
+glm::vec3 OceanCurrent::sample(glm::vec3 position)
+{
+    float x = position.x / cellSize - 0.5f;
+    float y = position.z / cellSize - 0.5f;
+    return glm::vec3(interpolate(u, x, y), 0.0f, interpolate(v, x, y));
+}
+
+glm::vec3 OceanCurrent::getDrive()
+{
+    return drive;
+}
+
+void OceanCurrent::bind(Shader* shader)
+{
+    if(texture == 0)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, resolution, resolution, 0, GL_RG, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        texels.resize(resolution * resolution);
+    }
+
+    //x is the texture's s axis and z its t axis
+    for(int y = 0; y < resolution; y++)
+    {
+        for(int x = 0; x < resolution; x++)
+        {
+            int i = index(x, y);
+            texels[y * resolution + x] = glm::vec2(u[i], v[i]);
+        }
+    }
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resolution, resolution, GL_RG, GL_FLOAT, texels.data());
+    glActiveTexture(GL_TEXTURE0);
+
+    shader->set(fieldUniform, 2);
+    shader->set(inverseSizeUniform, 1.0f / worldSize);
+    shader->set(strengthUniform, strength);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "Config.h"
+#include "Shader.h"
+#include "WorkerPool.h"
+
+class Terrain;
+
+//horizontal flow of the ocean over the whole terrain, simulated as a 2d fluid
+//every step the flow is pulled towards the overall current, carried along itself (advection),
+//smoothed (diffusion) and made divergence free (pressure projection) so it goes around
+//the ridges of the heightfield instead of through them
+//the grid is split in square tiles run on a worker pool, the stencil passes use sse
+class OceanCurrent
+{
+    public:
+
+    //grid over [0, worldSize] on x and z, cells where the terrain rises above the configured height are solid
+    //the tiles are stepped on pool, which is shared and only used from the thread calling simulate
+    OceanCurrent(float worldSize, ConfigSection* config, Terrain* terrain, WorkerPool& pool);
+
+    //advance the flow
+    void simulate(float deltaTime);
+
+    //flow at a world position in units per second, y is always 0
+    glm::vec3 sample(glm::vec3 position);
+
+    //overall current the flow is pulled towards, same everywhere
+    glm::vec3 getDrive();
+
+    //upload the flow to a texture on unit 2 so the shader can sample it (currentField)
+    //needs the gl context, the simulation itself doesn't
+    void bind(Shader* shader);
+
+    private:
+
+    //cells per tile side, the resolution is rounded up to a multiple of it
+    static const int tileSize = 32;
+
+    int resolution;
+    //row length, one ghost cell on each side
+    int stride;
+    int tiles;
+    float worldSize;
+    float cellSize;
+
+    //overall current and how fast the flow follows it
+    glm::vec3 direction;
+    float strength;
+    float relax;
+    glm::vec3 drive;
+    float time = 0.0f;
+
+    float viscosity;
+    int diffuseIterations;
+    int pressureIterations;
+
+    //velocity on x and z, the ghost ring holds the drive so the current flows in from the edges
+    std::vector<float> u, v;
+    //scratch velocity for advection and diffusion
+    std::vector<float> uPrevious, vPrevious, uNext, vNext;
+
+    //pressure, the ghost ring stays 0 so the edges are open
+    std::vector<float> pressure, pressureNext;
+    std::vector<float> divergence;
+
+    //1 for water, 0 for solid cells, per cell and for each neighbour
+    std::vector<float> open, openLeft, openRight, openDown, openUp;
+    //1 / open neighbours, 0 for solid cells
+    std::vector<float> openInverse;
+
+    WorkerPool& pool;
+
+    //flow as read by the shader, one texel per cell
+    GLuint texture = 0;
+    std::vector<glm::vec2> texels;
+
+    static Uniform<int> fieldUniform;
+    static Uniform<float> inverseSizeUniform;
+    static Uniform<float> strengthUniform;
+
+    int index(int x, int y);
+
+    //run kernel(x0, y0, x1, y1) on every tile in parallel
+    void forEachTile(const std::function<void(int, int, int, int)>& kernel);
+
+    //put the drive in the ghost ring of a velocity pair
+    void setGhosts(std::vector<float>& x, std::vector<float>& z);
+
+    //bilinear read of a field, position in cells from the first cell's center
+    float interpolate(const std::vector<float>& field, float x, float y);
+
+    void force(float deltaTime);
+    void advect(float deltaTime);
+    void diffuse(float deltaTime);
+    void project();
+};
@@ -0,0 +1,291 @@
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <emmintrin.h>
+
+ParticleSystem::ParticleKind ParticleSystem::readKind(ConfigSection* section)
+{
+    ParticleKind kind;
+    kind.lift = section->getFloat("lift");
+    kind.drag = section->getFloat("drag");
+    kind.size = section->getFloat("size");
+    kind.life = section->getFloat("life");
+    if(kind.life <= 0.0f)
+    {
+        kind.life = std::numeric_limits<float>::max();
+    }
+    kind.color = glm::vec4(section->getFloat("red"), section->getFloat("green"), section->getFloat("blue"), section->getFloat("alpha"));
+    return kind;
+}
+
+ParticleSystem::ParticleSystem(uint64_t seed, WorkerPool& pool) : random(seed), pool(pool)
+{
+    Config config("res/config/Particles.config");
+    ConfigSection* section = config.getConfig();
+
+    //multiples of four so every sse step is only snow or only other particles
+    capacity = (section->getInt("capacity") + 3) & ~3;
+    snowCount = std::min(capacity, (section->getInt("snowCount") + 3) & ~3);
+    snowRange = section->getFloat("snowRange");
+    bubbleRate = section->getFloat("bubbleRate");
+    siltCount = section->getInt("siltCount");
+
+    const char* names[PARTICLE_TYPES] = {"snow", "bubble", "silt"};
+    for(int type = 0; type < PARTICLE_TYPES; type++)
+    {
+        kinds[type] = readKind(section->getSection(names[type]));
+    }
+
+    for(auto array : {&x, &y, &z, &velocityX, &velocityY, &velocityZ, &age, &life, &lift, &drag, &scale, &flowX, &flowZ})
+    {
+        array->assign(capacity, 0.0f);
+    }
+    color.assign(capacity, 0);
+    instances.resize(capacity);
+
+    //snow starts spread around the origin, the first step wraps it around the camera
+    for(int i = 0; i < snowCount; i++)
+    {
+        glm::vec3 position(random.uniform(-snowRange, snowRange), random.uniform(-snowRange, snowRange), random.uniform(-snowRange, snowRange));
+        emit(PARTICLE_SNOW, position, glm::vec3(0.0f));
+    }
+}
+
+GLuint ParticleSystem::packColor(glm::vec4 color)
+{
+    //red in the first byte, read as normalized bytes by the shader
+    GLuint channels[4];
+    for(int i = 0; i < 4; i++)
+    {
+        channels[i] = GLuint(std::min(std::max(color[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+    return channels[0] | (channels[1] << 8) | (channels[2] << 16) | (channels[3] << 24);
+}
+
+void ParticleSystem::emit(ParticleType type, glm::vec3 position, glm::vec3 velocity)
+{
+    if(count >= capacity)
+    {
+        return;
+    }
+
+    const ParticleKind& kind = kinds[type];
+    int i = count++;
+
+    x[i] = position.x;
+    y[i] = position.y;
+    z[i] = position.z;
+    velocityX[i] = velocity.x;
+    velocityY[i] = velocity.y;
+    velocityZ[i] = velocity.z;
+    age[i] = 0.0f;
+    life[i] = kind.life * random.uniform(0.75f, 1.25f);
+    lift[i] = kind.lift;
+    drag[i] = kind.drag;
+    scale[i] = kind.size * random.uniform(0.5f, 1.5f);
+    color[i] = packColor(kind.color);
+}
+
+void ParticleSystem::emitBubbles(glm::vec3 position, float deltaTime)
+{
+    //a fraction of a bubble this frame becomes a whole one some of the time
+    int amount = int(bubbleRate * deltaTime + random.uniform());
+    for(int i = 0; i < amount; i++)
+    {
+        glm::vec3 offset(random.uniform(-0.2f, 0.2f), random.uniform(-0.2f, 0.2f), random.uniform(-0.2f, 0.2f));
+        glm::vec3 velocity(random.uniform(-0.5f, 0.5f), random.uniform(0.0f, 1.0f), random.uniform(-0.5f, 0.5f));
+        emit(PARTICLE_BUBBLE, position + offset, velocity);
+    }
+}
+
+void ParticleSystem::emitSilt(glm::vec3 position)
+{
+    for(int i = 0; i < siltCount; i++)
+    {
+        //thrown up and out, the drag stops it quickly
+        glm::vec3 velocity(random.uniform(-1.0f, 1.0f), random.uniform(0.2f, 1.0f), random.uniform(-1.0f, 1.0f));
+        emit(PARTICLE_SILT, position, velocity * random.uniform(2.0f, 6.0f));
+    }
+}
+
+void ParticleSystem::simulate(float deltaTime, OceanCurrent* current, glm::vec3 cameraPosition)
+{
+    //long frames would make the drag overshoot
+    deltaTime = std::min(deltaTime, 0.05f);
+
+    int padded = (count + 3) & ~3;
+    int blocks = (padded + blockSize - 1) / blockSize;
+    pool.parallelFor(blocks, [this, padded, deltaTime, current, cameraPosition](int block)
+    {
+        int begin = block * blockSize;
+        integrate(begin, std::min(begin + blockSize, padded), deltaTime, current, cameraPosition);
+    });
+
+    //snow lives forever, the rest is dropped once old
+    int i = snowCount;
+    while(i < count)
+    {
+        if(age[i] >= life[i])
+        {
+            remove(i);
+            continue;
+        }
+        i++;
+    }
+
+    blocks = (count + blockSize - 1) / blockSize;
+    pool.parallelFor(blocks, [this](int block)
+    {
+        int begin = block * blockSize;
+        pack(begin, std::min(begin + blockSize, count));
+    });
+}
+
+void ParticleSystem::integrate(int begin, int end, float deltaTime, OceanCurrent* current, glm::vec3 cameraPosition)
+{
+    //the flow is a bilinear read of the grid, no use doing it four at a time
+    for(int i = begin; i < std::min(end, count); i++)
+    {
+        glm::vec3 flow = current->sample(glm::vec3(x[i], y[i], z[i]));
+        flowX[i] = flow.x;
+        flowZ[i] = flow.z;
+    }
+
+    const __m128 step = _mm_set1_ps(deltaTime);
+
+    const __m128 boxSize = _mm_set1_ps(2.0f * snowRange);
+    const __m128 inverseBoxSize = _mm_set1_ps(0.5f / snowRange);
+    const __m128 cameraX = _mm_set1_ps(cameraPosition.x);
+    const __m128 cameraY = _mm_set1_ps(cameraPosition.y);
+    const __m128 cameraZ = _mm_set1_ps(cameraPosition.z);
+
+    for(int i = begin; i < end; i += 4)
+    {
+        //velocity moves towards the water's, lift pushes up or down on top of it
+        __m128 pull = _mm_mul_ps(_mm_loadu_ps(&drag[i]), step);
+
+        __m128 vx = _mm_loadu_ps(&velocityX[i]);
+        __m128 vy = _mm_loadu_ps(&velocityY[i]);
+        __m128 vz = _mm_loadu_ps(&velocityZ[i]);
+
+        vx = _mm_add_ps(vx, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&flowX[i]), vx), pull));
+        vy = _mm_add_ps(vy, _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(&lift[i]), step), _mm_mul_ps(vy, pull)));
+        vz = _mm_add_ps(vz, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&flowZ[i]), vz), pull));
+
+        __m128 px = _mm_add_ps(_mm_loadu_ps(&x[i]), _mm_mul_ps(vx, step));
+        __m128 py = _mm_add_ps(_mm_loadu_ps(&y[i]), _mm_mul_ps(vy, step));
+        __m128 pz = _mm_add_ps(_mm_loadu_ps(&z[i]), _mm_mul_ps(vz, step));
+
+        //snow leaving the box comes back on the other side
+        if(i < snowCount)
+        {
+            __m128 dx = _mm_sub_ps(px, cameraX);
+            __m128 dy = _mm_sub_ps(py, cameraY);
+            __m128 dz = _mm_sub_ps(pz, cameraZ);
+            dx = _mm_sub_ps(dx, _mm_mul_ps(boxSize, _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(dx, inverseBoxSize)))));
+            dy = _mm_sub_ps(dy, _mm_mul_ps(boxSize, _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(dy, inverseBoxSize)))));
+            dz = _mm_sub_ps(dz, _mm_mul_ps(boxSize, _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(dz, inverseBoxSize)))));
+            px = _mm_add_ps(cameraX, dx);
+            py = _mm_add_ps(cameraY, dy);
+            pz = _mm_add_ps(cameraZ, dz);
+        }
+
+        _mm_storeu_ps(&velocityX[i], vx);
+        _mm_storeu_ps(&velocityY[i], vy);
+        _mm_storeu_ps(&velocityZ[i], vz);
+        _mm_storeu_ps(&x[i], px);
+        _mm_storeu_ps(&y[i], py);
+        _mm_storeu_ps(&z[i], pz);
+        _mm_storeu_ps(&age[i], _mm_add_ps(_mm_loadu_ps(&age[i]), step));
+    }
+}
+
+void ParticleSystem::pack(int begin, int end)
+{
+    for(int i = begin; i < end; i++)
+    {
+        ParticleInstance& instance = instances[i];
+        instance.position = glm::vec3(x[i], y[i], z[i]);
+        instance.size = scale[i];
+
+        //fade out over the particle's life
+        float fade = 1.0f - age[i] / life[i];
+        GLuint alpha = GLuint((color[i] >> 24) * std::max(fade, 0.0f));
+        instance.color = (color[i] & 0x00ffffff) | (alpha << 24);
+    }
+}
+
+void ParticleSystem::remove(int index)
+{
+    count--;
+    for(auto array : {&x, &y, &z, &velocityX, &velocityY, &velocityZ, &age, &life, &lift, &drag, &scale, &flowX, &flowZ})
+    {
+        (*array)[index] = (*array)[count];
+    }
+    color[index] = color[count];
+}
+
+void ParticleSystem::submit(RenderQueue& queue, Shader* shader, glm::vec3 cameraPosition)
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    if(VAO == 0)
+    {
+        //corners of the quad, the shader turns it to face the camera
+        GLfloat corners[] = {
+            -1.0f, -1.0f,
+            1.0f, -1.0f,
+            -1.0f, 1.0f,
+            1.0f, 1.0f
+        };
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &quadVBO);
+        glGenBuffers(1, &instanceVBO);
+
+        glBindVertexArray(VAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
+        glEnableVertexAttribArray(0);
+
+        // Position and size, then the colour as four bytes
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (GLvoid*)offsetof(ParticleInstance, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleInstance), (GLvoid*)offsetof(ParticleInstance, color));
+        glEnableVertexAttribArray(2);
+        glVertexAttribDivisor(2, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    //new storage every frame so the driver doesn't wait for the last frame's draw
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(ParticleInstance) * count, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(ParticleInstance) * count, instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    //see-through, the blended pass keeps them from hiding each other
+    //they surround the camera so they are sorted from it
+    DrawPacket packet;
+    packet.shader = shader;
+    packet.VAO = VAO;
+    packet.mode = GL_TRIANGLE_STRIP;
+    packet.count = 4;
+    packet.instances = count;
+    queue.submit(PASS_BLENDED, packet, 0, cameraPosition);
+}
+
+int ParticleSystem::size()
+{
+    return count;
+}
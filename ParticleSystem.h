@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "Config.h"
+#include "Shader.h"
+#include "Random.h"
+#include "OceanCurrent.h"
+#include "WorkerPool.h"
+#include "RenderQueue.h"
+
+//kinds of particle, each moves and looks its own way
+enum ParticleType
+{
+    PARTICLE_SNOW,
+    PARTICLE_BUBBLE,
+    PARTICLE_SILT,
+    PARTICLE_TYPES
+};
+
+//small things floating in the water: marine snow around the camera, bubbles and silt
+//particles are stored as one array per attribute and stepped four at a time with sse,
+//split in blocks over a worker pool, then drawn as camera facing quads with one instanced draw
+//marine snow never dies, it is wrapped in a box around the camera so the same particles are always around
+class ParticleSystem
+{
+    public:
+
+    //settings come from res/config/Particles.config, the blocks run on pool, shared with the other systems of the frame
+    ParticleSystem(uint64_t seed, WorkerPool& pool);
+
+    //bubbles trailing something moving through the water, the amount depends on the time step
+    void emitBubbles(glm::vec3 position, float deltaTime);
+
+    //puff of silt thrown up where something hits the ground
+    void emitSilt(glm::vec3 position);
+
+    //move every particle with the current, drop the dead ones and keep the snow around the camera
+    void simulate(float deltaTime, OceanCurrent* current, glm::vec3 cameraPosition);
+
+    //send the particles to the gpu and queue one blended instanced draw for all of them
+    //the camera comes from the Frame block (see FrameUniforms)
+    void submit(RenderQueue& queue, Shader* shader, glm::vec3 cameraPosition);
+
+    int size();
+
+    private:
+
+    //particles per job of the worker pool, a multiple of four
+    static const int blockSize = 4096;
+
+    //look and motion shared by the particles of one type
+    struct ParticleKind
+    {
+        //upward acceleration when still, negative sinks
+        float lift;
+        //how fast the particle takes the speed of the water, per second
+        float drag;
+        float size;
+        //seconds before it disappears
+        float life;
+        glm::vec4 color;
+    };
+
+    ParticleKind kinds[PARTICLE_TYPES];
+
+    int capacity;
+    int count = 0;
+    //snow is the first particles of the arrays and never moves from there, a multiple of four
+    int snowCount;
+    //half the size of the box kept filled with snow around the camera
+    float snowRange;
+
+    float bubbleRate;
+    int siltCount;
+
+    Random random;
+
+    //one element per particle
+    std::vector<float> x, y, z;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> age, life;
+    std::vector<float> lift, drag, scale;
+    std::vector<GLuint> color;
+    //flow of the water at each particle, sampled every step
+    std::vector<float> flowX, flowZ;
+
+    //what the shader reads for every particle
+    struct ParticleInstance
+    {
+        glm::vec3 position;
+        float size;
+        //rgba, faded by age
+        GLuint color;
+    };
+    std::vector<ParticleInstance> instances;
+
+    WorkerPool& pool;
+
+    GLuint VAO = 0;
+    GLuint quadVBO = 0;
+    GLuint instanceVBO = 0;
+
+    //add a particle of a type, velocity in world space, nothing happens if every slot is taken
+    void emit(ParticleType type, glm::vec3 position, glm::vec3 velocity);
+
+    //step the particles in [begin, end)
+    void integrate(int begin, int end, float deltaTime, OceanCurrent* current, glm::vec3 cameraPosition);
+
+    //fill the instance data of the particles in [begin, end)
+    void pack(int begin, int end);
+
+    //move the last particle into a free slot
+    void remove(int index);
+
+    //settings of one type of particle, a life of 0 lives forever
+    static ParticleKind readKind(ConfigSection* section);
+
+    static GLuint packColor(glm::vec4 color);
+};
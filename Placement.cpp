@@ -0,0 +1,242 @@
+#include "Placement.h"
+
+#include <cmath>
+#include <algorithm>
+
+#define PI 3.14159265358979323846
+
+PlacementRules::PlacementRules(ConfigSection* section)
+{
+    rockSpacing = section->getFloat("rockSpacing");
+    coralSpacing = section->getFloat("coralSpacing");
+    seaweedSpacing = section->getFloat("seaweedSpacing");
+
+    rockCoralSpacing = section->getFloat("rockCoralSpacing");
+    seaweedClearance = section->getFloat("seaweedClearance");
+
+    patchSpacing = section->getFloat("patchSpacing");
+    patchRadius = section->getFloat("patchRadius");
+    seaweedPerPatch = section->getInt("seaweedPerPatch");
+
+    rockMaxSlope = section->getFloat("rockMaxSlope");
+    coralMaxSlope = section->getFloat("coralMaxSlope");
+    seaweedMaxSlope = section->getFloat("seaweedMaxSlope");
+
+    attempts = section->getInt("attempts");
+}
+
+PlacementGrid::PlacementGrid(float extent, float cellSize) : cellSize(cellSize)
+{
+    cells = std::max(1, (int)std::ceil(extent / cellSize));
+    buckets.resize(cells * cells);
+}
+
+int PlacementGrid::cellOf(float value) const
+{
+    int cell = (int)std::floor(value / cellSize);
+    return std::min(std::max(cell, 0), cells - 1);
+}
+
+void PlacementGrid::insert(glm::vec2 position, PlacementType type)
+{
+    buckets[cellOf(position.x) * cells + cellOf(position.y)].push_back({position, type});
+}
+
+bool PlacementGrid::isFree(glm::vec2 position, float distance, PlacementType type) const
+{
+    //only the cells overlapping the query square can hold a point that close
+    int minX = cellOf(position.x - distance);
+    int maxX = cellOf(position.x + distance);
+    int minY = cellOf(position.y - distance);
+    int maxY = cellOf(position.y + distance);
+
+    float distanceSquared = distance * distance;
+
+    for(int x = minX; x <= maxX; x++)
+    {
+        for(int y = minY; y <= maxY; y++)
+        {
+            for(const Point& point : buckets[x * cells + y])
+            {
+                glm::vec2 delta = point.position - position;
+                if(point.type == type && glm::dot(delta, delta) < distanceSquared)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+ChunkPlacer::ChunkPlacer(float** heightMap, int size, glm::vec2 origin, const PlacementRules& rules) :
+heightMap(heightMap), size(size), extent((float)(size - 1)), origin(origin), rules(rules), grid(extent, rules.seaweedSpacing * 2)
+{
+}
+
+void ChunkPlacer::place(uint64_t seed, ArenaVector<Placement>& placements)
+{
+    //placement stream of the chunk, entity seeds use the indices from 0 up
+    Random random(Random::derive(seed, -1));
+
+    //coral is the largest, place it first so rocks and seaweed fill around it
+    std::vector<glm::vec2> coral;
+    sample(random, grid, PLACEMENT_CORAL, rules.coralSpacing, coral);
+    for(auto& position : coral)
+    {
+        add(position, PLACEMENT_CORAL, Random::derive(seed, placements.size()), placements);
+    }
+
+    std::vector<glm::vec2> rocks;
+    sample(random, grid, PLACEMENT_ROCK, rules.rockSpacing, rocks);
+    for(auto& position : rocks)
+    {
+        add(position, PLACEMENT_ROCK, Random::derive(seed, placements.size()), placements);
+    }
+
+    //patch centers are kept apart in their own grid, seaweed is scattered around them
+    PlacementGrid patchGrid(extent, rules.patchSpacing);
+    std::vector<glm::vec2> patches;
+    sample(random, patchGrid, PLACEMENT_SEAWEED, rules.patchSpacing, patches);
+
+    for(auto& center : patches)
+    {
+        for(int i = 0; i < rules.seaweedPerPatch; i++)
+        {
+            //uniform point in the patch disk
+            float angle = random.uniform(0.0f, 2.0f * PI);
+            float distance = rules.patchRadius * std::sqrt(random.uniform());
+            glm::vec2 position = center + distance * glm::vec2(std::cos(angle), std::sin(angle));
+
+            if(accept(position, grid, PLACEMENT_SEAWEED, rules.seaweedSpacing))
+            {
+                grid.insert(position, PLACEMENT_SEAWEED);
+                add(position, PLACEMENT_SEAWEED, Random::derive(seed, placements.size()), placements);
+            }
+        }
+    }
+}
+
+void ChunkPlacer::sample(Random& random, PlacementGrid& target, PlacementType type, float spacing, std::vector<glm::vec2>& points)
+{
+    //points that may still have room around them
+    std::vector<glm::vec2> active;
+
+    //random starting points, used whenever the front dies out
+    //this also reaches areas cut off by slopes that are too steep
+    int darts = 0;
+
+    while(true)
+    {
+        if(active.empty())
+        {
+            if(darts >= rules.attempts)
+            {
+                return;
+            }
+            darts++;
+
+            float x = random.uniform(0.0f, extent);
+            float y = random.uniform(0.0f, extent);
+            glm::vec2 candidate(x, y);
+
+            if(accept(candidate, target, type, spacing))
+            {
+                target.insert(candidate, type);
+                points.push_back(candidate);
+                active.push_back(candidate);
+            }
+            continue;
+        }
+
+        //try candidates in the ring [spacing, 2*spacing] around a random active point
+        int index = random.range((int)active.size());
+        glm::vec2 center = active[index];
+        bool found = false;
+
+        for(int i = 0; i < rules.attempts && !found; i++)
+        {
+            float angle = random.uniform(0.0f, 2.0f * PI);
+            float distance = random.uniform(spacing, 2.0f * spacing);
+            glm::vec2 candidate = center + distance * glm::vec2(std::cos(angle), std::sin(angle));
+
+            if(accept(candidate, target, type, spacing))
+            {
+                target.insert(candidate, type);
+                points.push_back(candidate);
+                active.push_back(candidate);
+                found = true;
+            }
+        }
+
+        //no room left around this point
+        if(!found)
+        {
+            active[index] = active.back();
+            active.pop_back();
+        }
+    }
+}
+
+bool ChunkPlacer::accept(glm::vec2 position, const PlacementGrid& target, PlacementType type, float spacing) const
+{
+    //keep half the spacing from the chunk border, chunks are placed independently
+    //so this is what keeps entities of neighbouring chunks apart
+    float margin = spacing / 2;
+    if(position.x < margin || position.y < margin || position.x > extent - margin || position.y > extent - margin)
+    {
+        return false;
+    }
+
+    if(!target.isFree(position, spacing, type))
+    {
+        return false;
+    }
+
+    switch(type)
+    {
+        case PLACEMENT_ROCK:
+            return slopeAt(position) <= rules.rockMaxSlope
+                && grid.isFree(position, rules.rockCoralSpacing, PLACEMENT_CORAL);
+        case PLACEMENT_CORAL:
+            return slopeAt(position) <= rules.coralMaxSlope
+                && grid.isFree(position, rules.rockCoralSpacing, PLACEMENT_ROCK);
+        case PLACEMENT_SEAWEED:
+            return slopeAt(position) <= rules.seaweedMaxSlope
+                && grid.isFree(position, rules.seaweedClearance, PLACEMENT_ROCK)
+                && grid.isFree(position, rules.seaweedClearance, PLACEMENT_CORAL);
+    }
+    return false;
+}
+
+void ChunkPlacer::add(glm::vec2 position, PlacementType type, uint64_t seed, ArenaVector<Placement>& placements)
+{
+    Placement placement;
+    placement.type = type;
+    placement.position = glm::vec3(origin.x + position.x, heightAt(position), origin.y + position.y);
+    placement.seed = seed;
+    placements.push_back(placement);
+}
+
+float ChunkPlacer::heightAt(glm::vec2 position) const
+{
+    float x = std::min(std::max(position.x, 0.0f), extent);
+    float y = std::min(std::max(position.y, 0.0f), extent);
+
+    int x0 = std::min((int)x, size - 2);
+    int y0 = std::min((int)y, size - 2);
+    float fx = x - x0;
+    float fy = y - y0;
+
+    float h0 = heightMap[x0][y0] * (1 - fx) + heightMap[x0 + 1][y0] * fx;
+    float h1 = heightMap[x0][y0 + 1] * (1 - fx) + heightMap[x0 + 1][y0 + 1] * fx;
+    return h0 * (1 - fy) + h1 * fy;
+}
+
+float ChunkPlacer::slopeAt(glm::vec2 position) const
+{
+    //central differences over one heightmap cell
+    float dx = heightAt(position + glm::vec2(0.5f, 0.0f)) - heightAt(position - glm::vec2(0.5f, 0.0f));
+    float dy = heightAt(position + glm::vec2(0.0f, 0.5f)) - heightAt(position - glm::vec2(0.0f, 0.5f));
+    return std::sqrt(dx * dx + dy * dy);
+}
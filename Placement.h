@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vector>
+#include <GLM\glm.hpp>
+
+#include "Config.h"
+#include "Random.h"
+#include "ChunkArena.h"
+
+//kind of entity spawned by a placement
+enum PlacementType
+{
+    PLACEMENT_ROCK = 0,
+    PLACEMENT_CORAL = 1,
+    PLACEMENT_SEAWEED = 2
+};
+
+//entity to spawn, position is the world point on the terrain surface
+struct Placement
+{
+    PlacementType type;
+    glm::vec3 position;
+    uint64_t seed;
+};
+
+//density rules, read from the placement section of Terrain.config
+struct PlacementRules
+{
+    PlacementRules() {}
+    PlacementRules(ConfigSection* section);
+
+    //minimum distance between two entities of the same type
+    float rockSpacing = 8.0f;
+    float coralSpacing = 20.0f;
+    float seaweedSpacing = 2.0f;
+
+    //minimum distance between rocks and coral
+    float rockCoralSpacing = 4.0f;
+    //minimum distance between seaweed and rocks or coral
+    float seaweedClearance = 2.0f;
+
+    //seaweed grows in patches, patch centers are spaced like the other entities
+    float patchSpacing = 30.0f;
+    float patchRadius = 10.0f;
+    int seaweedPerPatch = 10;
+
+    //steepest terrain (height change per unit) an entity can stand on
+    float rockMaxSlope = 1.0f;
+    float coralMaxSlope = 0.3f;
+    float seaweedMaxSlope = 0.5f;
+
+    //candidates tried around a point before giving up on it
+    int attempts = 30;
+};
+
+//uniform grid of buckets over a chunk
+//distance queries only look at the cells around the position instead of every point
+class PlacementGrid
+{
+    public:
+    PlacementGrid(float extent, float cellSize);
+
+    void insert(glm::vec2 position, PlacementType type);
+
+    //true if no point of the given type is closer than distance
+    bool isFree(glm::vec2 position, float distance, PlacementType type) const;
+
+    private:
+    struct Point
+    {
+        glm::vec2 position;
+        PlacementType type;
+    };
+
+    float cellSize;
+    int cells;
+    std::vector<std::vector<Point>> buckets;
+
+    int cellOf(float value) const;
+};
+
+//poisson disk placement of the entities of one chunk
+//only reads the chunk's heightmap, so chunks can be placed on any thread in any order
+//and the same chunk seed always gives the same placements
+class ChunkPlacer
+{
+    public:
+    //heightmap of size*size points, origin is the world x/z of point [0][0]
+    ChunkPlacer(float** heightMap, int size, glm::vec2 origin, const PlacementRules& rules);
+
+    //append the placements of the chunk, coral first then rocks then seaweed patches
+    void place(uint64_t seed, ArenaVector<Placement>& placements);
+
+    private:
+    float** heightMap;
+    int size;
+
+    //chunk width in world units
+    float extent;
+    glm::vec2 origin;
+
+    const PlacementRules& rules;
+
+    //every entity placed so far, local coordinates
+    PlacementGrid grid;
+
+    //bridson sampling, fills the chunk with points at least spacing apart in target
+    void sample(Random& random, PlacementGrid& target, PlacementType type, float spacing, std::vector<glm::vec2>& points);
+
+    //bounds, slope and spacing rules for a candidate point
+    bool accept(glm::vec2 position, const PlacementGrid& target, PlacementType type, float spacing) const;
+
+    void add(glm::vec2 position, PlacementType type, uint64_t seed, ArenaVector<Placement>& placements);
+
+    //bilinear height and gradient length of the heightmap at a local position
+    float heightAt(glm::vec2 position) const;
+    float slopeAt(glm::vec2 position) const;
+};
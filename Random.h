@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+//Small, fast and seedable random number generator (xoshiro128**)
+//16 bytes of state, no system calls, same sequence for a given seed on every platform
+//
+//Seeds for sub-streams are derived from a parent seed with Random::derive, ie
+//world seed -> chunk seed (chunk coordinates) -> entity seed (index in chunk)
+class Random
+{
+public:
+
+	explicit Random(uint64_t seed = 0)
+	{
+		// Expand the seed with splitmix64, the state must not be all zero
+		uint64_t a = splitmix(seed);
+		uint64_t b = splitmix(seed);
+		state[0] = uint32_t(a);
+		state[1] = uint32_t(a >> 32);
+		state[2] = uint32_t(b);
+		state[3] = uint32_t(b >> 32);
+	}
+
+	// Next 32 random bits
+	uint32_t next()
+	{
+		uint32_t result = rotl(state[1] * 5, 7) * 9;
+		uint32_t t = state[1] << 9;
+
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 11);
+
+		return result;
+	}
+
+	// Next 64 random bits, high word first
+	// drawn in separate statements, the order of two calls in one expression is up to the compiler
+	uint64_t next64()
+	{
+		uint64_t high = next();
+		uint64_t low = next();
+		return (high << 32) | low;
+	}
+
+	// Uniform float in [0, 1)
+	float uniform()
+	{
+		return (next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// Uniform float in [min, max)
+	float uniform(float min, float max)
+	{
+		return min + (max - min) * uniform();
+	}
+
+	// Uniform integer in [0, n)
+	int range(int n)
+	{
+		return int((uint64_t(next()) * uint64_t(n)) >> 32);
+	}
+
+	// Poisson distributed integer, fine for the small means used by entities
+	int poisson(float mean)
+	{
+		float limit = std::exp(-mean);
+		float product = uniform();
+		int count = 0;
+		while (product > limit)
+		{
+			product *= uniform();
+			count++;
+		}
+		return count;
+	}
+
+	// Seed of an independent sub-stream, ie derive(worldSeed, chunkX, chunkY)
+	static uint64_t derive(uint64_t seed, int64_t a, int64_t b = 0, int64_t c = 0)
+	{
+		uint64_t h = mix(seed);
+		h = mix(h ^ uint64_t(a));
+		h = mix(h ^ uint64_t(b));
+		h = mix(h ^ uint64_t(c));
+		return h;
+	}
+
+private:
+
+	uint32_t state[4];
+
+	static uint32_t rotl(uint32_t x, int k)
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+
+	// splitmix64 step, advances x
+	static uint64_t splitmix(uint64_t& x)
+	{
+		x += 0x9E3779B97F4A7C15ull;
+		return mix(x);
+	}
+
+	// splitmix64 finalizer
+	static uint64_t mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+};
@@ -0,0 +1,212 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+//bits of every field of the sort key, from the most significant
+static const int passBits = 2;
+static const int shaderBits = 6;
+static const int depthBits = 24;
+static const uint64_t depthMax = (1u << depthBits) - 1;
+
+void RenderQueue::begin(glm::vec3 viewPosition, float farDistance)
+{
+    this->viewPosition = viewPosition;
+    this->farDistance = std::max(farDistance, 1.0f);
+
+    packets.clear();
+    keys.clear();
+    order.clear();
+}
+
+void RenderQueue::submit(RenderPass pass, const DrawPacket& packet, uint16_t material, glm::vec3 center)
+{
+    float distance = glm::length(center - viewPosition) / farDistance;
+    uint64_t depth = (uint64_t)(std::min(std::max(distance, 0.0f), 1.0f) * depthMax);
+    uint64_t shader = shaderId(packet.shader);
+    //only used to group draws, names past 16 bits just share a slot
+    uint64_t vertexArray = packet.VAO & 0xffff;
+
+    uint64_t key = (uint64_t)pass << (64 - passBits);
+    if(pass == PASS_OPAQUE)
+    {
+        //state first, front to back within the same state
+        key |= shader << (64 - passBits - shaderBits);
+        key |= (uint64_t)material << 40;
+        key |= vertexArray << 24;
+        key |= depth;
+    }
+    else
+    {
+        //back to front first, see-through draws must cover what is behind them
+        key |= (depthMax - depth) << (64 - passBits - depthBits);
+        key |= shader << 32;
+        key |= (uint64_t)material << 16;
+        key |= vertexArray;
+    }
+
+    keys.push_back(key);
+    order.push_back(packets.size());
+    packets.push_back(packet);
+}
+
+void RenderQueue::execute()
+{
+    sort();
+
+    //state may have been changed by anything since the last execute
+    currentProgram = 0;
+    currentVAO = 0;
+    currentPass = -1;
+    drawCount = 0;
+    stateChanges = 0;
+    bool programKnown = false;
+    bool vertexArrayKnown = false;
+
+    for(int i = 0; i < order.size(); i++)
+    {
+        const DrawPacket& packet = packets[order[i]];
+
+        setPass(keys[i] >> (64 - passBits));
+
+        if(!programKnown || currentProgram != packet.shader->program)
+        {
+            useProgram(packet.shader);
+            programKnown = true;
+        }
+
+        if(!vertexArrayKnown || currentVAO != packet.VAO)
+        {
+            bindVertexArray(packet.VAO);
+            vertexArrayKnown = true;
+        }
+
+        if(packet.apply != nullptr)
+        {
+            packet.apply(packet.shader, packet.owner);
+        }
+
+        if(packet.indirect != 0)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, packet.indirect);
+            glMultiDrawArraysIndirect(packet.mode, 0, packet.count, 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        else if(packet.firsts != nullptr)
+        {
+            glMultiDrawArrays(packet.mode, packet.firsts, packet.counts, packet.count);
+        }
+        else if(packet.instances > 0)
+        {
+            glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.instances);
+        }
+        else
+        {
+            glDrawArrays(packet.mode, packet.first, packet.count);
+        }
+        drawCount++;
+    }
+
+    //leave the default state for code drawing outside the queue
+    glBindVertexArray(0);
+    setPass(PASS_OPAQUE);
+}
+
+int RenderQueue::getDrawCount()
+{
+    return drawCount;
+}
+
+int RenderQueue::getStateChanges()
+{
+    return stateChanges;
+}
+
+int RenderQueue::shaderId(Shader* shader)
+{
+    for(int i = 0; i < shaders.size(); i++)
+    {
+        if(shaders[i] == shader)
+        {
+            return i;
+        }
+    }
+
+    shaders.push_back(shader);
+    return (shaders.size() - 1) & ((1 << shaderBits) - 1);
+}
+
+void RenderQueue::sort()
+{
+    int count = keys.size();
+    keysScratch.resize(count);
+    orderScratch.resize(count);
+
+    for(int shift = 0; shift < 64; shift += 8)
+    {
+        int histogram[256] = {};
+        for(int i = 0; i < count; i++)
+        {
+            histogram[(keys[i] >> shift) & 0xff]++;
+        }
+
+        //every key has the same digit, this pass wouldn't move anything
+        if(count == 0 || histogram[(keys[0] >> shift) & 0xff] == count)
+        {
+            continue;
+        }
+
+        int offset = 0;
+        for(int digit = 0; digit < 256; digit++)
+        {
+            int size = histogram[digit];
+            histogram[digit] = offset;
+            offset += size;
+        }
+
+        for(int i = 0; i < count; i++)
+        {
+            int target = histogram[(keys[i] >> shift) & 0xff]++;
+            keysScratch[target] = keys[i];
+            orderScratch[target] = order[i];
+        }
+
+        keys.swap(keysScratch);
+        order.swap(orderScratch);
+    }
+}
+
+void RenderQueue::setPass(int pass)
+{
+    if(pass == currentPass)
+    {
+        return;
+    }
+
+    if(pass == PASS_BLENDED)
+    {
+        glEnable(GL_BLEND);
+        glDepthMask(GL_FALSE);
+    }
+    else
+    {
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+    }
+
+    currentPass = pass;
+    stateChanges++;
+}
+
+void RenderQueue::useProgram(Shader* shader)
+{
+    shader->use();
+    currentProgram = shader->program;
+    stateChanges++;
+}
+
+void RenderQueue::bindVertexArray(GLuint VAO)
+{
+    glBindVertexArray(VAO);
+    currentVAO = VAO;
+    stateChanges++;
+}
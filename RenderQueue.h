@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "Shader.h"
+
+//passes run in this order, opaque geometry first with blending off,
+//then see-through geometry back to front with blending on and depth writes off
+enum RenderPass
+{
+    PASS_OPAQUE,
+    PASS_BLENDED
+};
+
+//everything needed to issue one draw call
+struct DrawPacket
+{
+    Shader* shader;
+    GLuint VAO;
+    GLenum mode = GL_TRIANGLES;
+    GLint first = 0;
+    GLsizei count = 0;
+    //instances to draw, 0 for a draw without instancing
+    GLsizei instances = 0;
+    //buffer of count DrawArraysIndirectCommand drawn by one glMultiDrawArraysIndirect, 0 for a direct draw
+    //first and instances are ignored, they come from the commands
+    GLuint indirect = 0;
+    //first vertex and vertex count of count draws issued by one glMultiDrawArrays, null for a single draw
+    //they are read when the queue executes, so they have to outlive the frame's submit
+    const GLint* firsts = nullptr;
+    const GLsizei* counts = nullptr;
+
+    //sets the uniforms only this draw needs, called with its shader in use, can be null
+    //uniforms are cached by the shader so values shared by consecutive draws are not sent again
+    void (*apply)(Shader* shader, void* owner) = nullptr;
+    void* owner = nullptr;
+};
+
+//draws of a frame collected from every system, sorted then issued at once
+//the sort key puts the pass first, then shader, material and vertex array so draws sharing state
+//end up next to each other, opaque draws end with depth (front to back) and blended draws start with it (back to front)
+//state is only changed when it differs from the last draw, so changes scale with distinct states, not objects
+class RenderQueue
+{
+    public:
+
+    //start collecting a frame, depth is the distance from viewPosition, anything past farDistance sorts last
+    void begin(glm::vec3 viewPosition, float farDistance);
+
+    //add a draw, material is its palette index and center the world position it is sorted by
+    void submit(RenderPass pass, const DrawPacket& packet, uint16_t material, glm::vec3 center);
+
+    //sort and issue every draw of the frame, leaves no vertex array bound, blending off and depth writes on
+    void execute();
+
+    //draws and state changes (program, vertex array and pass switches) of the last execute
+    int getDrawCount();
+    int getStateChanges();
+
+    private:
+
+    glm::vec3 viewPosition;
+    float farDistance = 1.0f;
+
+    std::vector<DrawPacket> packets;
+    //sort key and packet index, sorted together
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> order;
+    std::vector<uint64_t> keysScratch;
+    std::vector<uint32_t> orderScratch;
+
+    //shaders seen so far, their position is the id used in the keys
+    std::vector<Shader*> shaders;
+
+    //gl state as last set by execute
+    GLuint currentProgram;
+    GLuint currentVAO;
+    int currentPass;
+
+    int drawCount = 0;
+    int stateChanges = 0;
+
+    //small id of a shader, stable for the life of the queue
+    int shaderId(Shader* shader);
+
+    //least significant digit radix sort of keys and order, 8 bits per pass
+    //passes where every key has the same digit are skipped
+    void sort();
+
+    void setPass(int pass);
+    void useProgram(Shader* shader);
+    void bindVertexArray(GLuint VAO);
+};
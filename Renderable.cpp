@@ -1 +1,61 @@
-#pragma once
\ No newline at end of file
+#include "Renderable.h"
+#include "ChunkBatch.h"
+
+#include <algorithm>
+
+//handles shared by every entity drawn on its own
+static Uniform<glm::mat4> modelUniform("model");
+static Uniform<glm::mat3> normalMatrixUniform("normalMatrix");
+
+void Renderable::applyModel(Shader* shader)
+{
+    shader->set(modelUniform, model);
+    shader->set(normalMatrixUniform, glm::mat3(glm::transpose(glm::inverse(model))));
+}
+
+Bounds Renderable::getBounds()
+{
+    Bounds bounds;
+    bounds.center = glm::vec3(model[3]);
+    bounds.radius = std::max(radius, 0.0f);
+    return bounds;
+}
+
+void Renderable::applyDraw(Shader* shader, void* owner)
+{
+    Renderable* entity = (Renderable*)owner;
+    shader->set(ChunkBatch::batchModeUniform, 0);
+    entity->material.apply(shader);
+    entity->applyModel(shader);
+}
+
+void Renderable::submit(RenderQueue& queue, Shader* shader)
+{
+    GLsizei count = drawCount();
+    if(count == 0 || VAO == 0)
+    {
+        return;
+    }
+    
+    DrawPacket packet;
+    packet.shader = shader;
+    packet.VAO = VAO;
+    packet.count = count;
+    packet.apply = applyDraw;
+    packet.owner = this;
+    queue.submit(PASS_OPAQUE, packet, material.index, glm::vec3(model[3]));
+}
+
+void Renderable::render(Shader* shader)
+{
+    GLsizei count = drawCount();
+    if(count == 0 || VAO == 0)
+    {
+        return;
+    }
+    
+    applyDraw(shader, this);
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, count);
+    glBindVertexArray(0);
+}
@@ -8,6 +8,10 @@
 
 #include "Shader.h"
 #include "Material.h"
+#include "RenderQueue.h"
+#include "Components.h"
+
+class ChunkBatch;
 
 class Renderable 
 {
@@ -25,12 +29,46 @@ class Renderable
     
     float radius = -1;
     
-    virtual void render(Shader* shader) {};
+    virtual ~Renderable() {};
+    
+    //vertices of the entity's own VAO to draw, 0 if it has nothing to draw on its own
+    virtual GLsizei drawCount() { return 0; };
     virtual void animate(float deltaTime) {};
     
+    //world space sphere around everything the entity draws, used for culling
+    //by default the model's origin and radius
+    virtual Bounds getBounds();
+    
+    //queue a draw of the entity's own VAO with its material and model matrix
+    void submit(RenderQueue& queue, Shader* shader);
+    
+    //draw the entity's own VAO right away, outside of any queue
+    void render(Shader* shader);
+    
     virtual bool load() { return true; };
     virtual void unload() {};
     
+    //add static geometry to a chunk batch
+    //returns false if the entity can't be batched and has to be rendered on its own
+    virtual bool bake(ChunkBatch& batch) { return false; };
+    
+    //add the next part of baked geometry to the space reserved for it in the batch (see ChunkBatch::addGrowing)
+    //budget is the number of growth steps left this frame, returns false once fully grown
+    virtual bool grow(ChunkBatch& batch, int& budget) { return false; };
+    
+    //send model and normal matrix to the shader in use
+    void applyModel(Shader* shader);
+    
+    //uniforms of a single entity draw, owner is the Renderable (see DrawPacket::apply)
+    static void applyDraw(Shader* shader, void* owner);
+    
+    //free the cpu copy of the geometry once it is on the gpu or baked
+    void releaseGeometry()
+    {
+        std::vector<glm::vec3>().swap(vertices);
+        std::vector<GLuint>().swap(indices);
+    };
+    
     private:
     
 };
@@ -1,9 +1,9 @@
 #pragma once
 
 #include "Rock.h"
+#include "ChunkBatch.h"
 #include <GLM/glm.hpp>
 #include <GLM/gtc/matrix_transform.inl>
-#include <random>
 
 #define PI 3.14159265358979323846
 
@@ -23,35 +23,35 @@ glm::vec3 Rock::calculateNormal(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3)
     return normal;
 }
 
-Rock::Rock(glm::vec3 position)
+void Rock::generateGeometry(Random& random)
 {
     float const X = 0.525731112119133606f;
     float const Z = 0.850650808352039932f;
     
-	// max radius size for bounding box
-    radius = 1.6;
-    
-    // randon generators
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    
-    // uniform distribution for the rocks
-    std::uniform_real_distribution<> nudge(-0.3, 0.3);
+    // random displacement for every vertex, drawn one at a time so a seed always gives the same rock
+    glm::vec3 nudge[12];
+    for (int i = 0; i < 12; i++)
+    {
+        float nx = random.uniform(-0.3f, 0.3f);
+        float ny = random.uniform(-0.3f, 0.3f);
+        float nz = random.uniform(-0.3f, 0.3f);
+        nudge[i] = glm::vec3(nx, ny, nz);
+    }
     
     // set the vertices with random displacement
     glm::vec3 rockVertices[] = {
-        /*0*/	glm::vec3(-X + nudge(gen), 0 + nudge(gen), Z + nudge(gen)),
-        /*1*/	glm::vec3(X + nudge(gen), 0 + nudge(gen), Z + nudge(gen)),
-        /*2*/	glm::vec3(-X + nudge(gen), 0 + nudge(gen), -Z + nudge(gen)),
-        /*3*/	glm::vec3(X + nudge(gen), 0 + nudge(gen), -Z + nudge(gen)),
-        /*4*/	glm::vec3(0 + nudge(gen), Z + nudge(gen), X + nudge(gen)),
-        /*5*/	glm::vec3(0 + nudge(gen), Z + nudge(gen), -X + nudge(gen)),
-        /*6*/	glm::vec3(0 + nudge(gen), -Z + nudge(gen), X + nudge(gen)),
-        /*7*/	glm::vec3(0 + nudge(gen), -Z + nudge(gen), -X + nudge(gen)),
-        /*8*/	glm::vec3(Z + nudge(gen), X + nudge(gen), 0 + nudge(gen)),
-        /*9*/	glm::vec3(-Z + nudge(gen), X + nudge(gen), 0 + nudge(gen)),
-        /*10*/	glm::vec3(Z + nudge(gen), -X + nudge(gen), 0 + nudge(gen)),
-        /*11*/	glm::vec3(-Z + nudge(gen), -X + nudge(gen), 0 + nudge(gen)),
+        /*0*/	glm::vec3(-X, 0, Z) + nudge[0],
+        /*1*/	glm::vec3(X, 0, Z) + nudge[1],
+        /*2*/	glm::vec3(-X, 0, -Z) + nudge[2],
+        /*3*/	glm::vec3(X, 0, -Z) + nudge[3],
+        /*4*/	glm::vec3(0, Z, X) + nudge[4],
+        /*5*/	glm::vec3(0, Z, -X) + nudge[5],
+        /*6*/	glm::vec3(0, -Z, X) + nudge[6],
+        /*7*/	glm::vec3(0, -Z, -X) + nudge[7],
+        /*8*/	glm::vec3(Z, X, 0) + nudge[8],
+        /*9*/	glm::vec3(-Z, X, 0) + nudge[9],
+        /*10*/	glm::vec3(Z, -X, 0) + nudge[10],
+        /*11*/	glm::vec3(-Z, -X, 0) + nudge[11],
     };
     
     // get surface normals for lighting
@@ -162,49 +162,60 @@ Rock::Rock(glm::vec3 position)
         /*2*/	rockVertices[2], surfaceNormals[surface],
         /*7*/	rockVertices[7], surfaceNormals[surface]
     };
+}
+
+Rock::Rock(glm::vec3 position, uint64_t seed) : seed(seed)
+{
+	// max radius size for bounding box
+    radius = 1.6;
+    
+    // random generator, same rock for the same seed
+    Random random(seed);
+    
+    generateGeometry(random);
     
     // Apply translation to model matrix
     model = glm::translate(model, -position);
     
     // Apply scale to model matrix
-    if (rand() % 100 == 99)
+    if (random.range(100) == 99)
     {
         radius *= 6;
         model = glm::scale(model, glm::vec3(6.0f, 6.0f, 6.0f));
     }
     else
     {
-        float scaler = rand() % 4;
+        float scaler = random.range(4);
         radius *= scaler;
         model = glm::scale(model, glm::vec3(scaler, scaler, scaler));
     }
     
     // Apply rotations to model matrix
-    std::uniform_real_distribution<> dis(0, 1);
-    glm::vec3 eulerXYZ(dis(gen) * PI, dis(gen) * PI, dis(gen) * PI);
+    glm::vec3 eulerXYZ;
+    eulerXYZ.x = random.uniform() * PI;
+    eulerXYZ.y = random.uniform() * PI;
+    eulerXYZ.z = random.uniform() * PI;
     
     model = glm::rotate(model, eulerXYZ.x, glm::vec3(1.0f, 0.0f, 0.0f));
     model = glm::rotate(model, eulerXYZ.y, glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::rotate(model, eulerXYZ.z, glm::vec3(0.0f, 0.0f, 1.0f));
     
     // randomize whether colour will be shade of brown or grey
-    int colorType = rand() % 10;
+    int colorType = random.range(10);
     // initialize placeholder for colour float value
     double color;
     // brown rock
     if (colorType > 6) 
     {
         // pick a shade
-        std::uniform_real_distribution<> colorDis(0.4, 0.6);
-        color = colorDis(gen);
+        color = random.uniform(0.4f, 0.6f);
         // Assign material
         material = Material(glm::vec3(0.3, 0.15, 0), glm::vec3(color, color / 2, color / 6), glm::vec3(0.25), 0.4);
     }
     else // grey rock
     {
         // pick a shade
-        std::uniform_real_distribution<> colorDis(0.3, 0.4);
-        color = colorDis(gen);
+        color = random.uniform(0.3f, 0.4f);
         // Assign material
         material = Material(glm::vec3(0.25), glm::vec3(color, color, color), glm::vec3(0.25), 0.4);
     }
@@ -216,6 +227,13 @@ bool Rock::load()
     
     if(VAO == 0)
     {
+        // geometry was released after an earlier upload or bake
+        if (vertices.empty())
+        {
+            Random random(seed);
+            generateGeometry(random);
+        }
+        
         // Generate buffers
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -236,6 +254,8 @@ bool Rock::load()
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
         
+        releaseGeometry();
+        
         return true;
     }
     return false;
@@ -252,39 +272,40 @@ void Rock::unload()
     VAO = 0;
 }
 
-// render the rocks
-void Rock::render(Shader* shader)
+// vertices drawn for the rock on its own
+GLsizei Rock::drawCount()
 {
-	// update normal matrix
-	glm::mat3 normalMatrix = glm::transpose(glm::inverse(model));
-    
-    
-    // Broadcast the uniform values to the shaders
-    
-    GLint matAmbientLoc = glGetUniformLocation(shader->program, "material.ambient");
-    GLint matDiffuseLoc = glGetUniformLocation(shader->program, "material.diffuse");
-    GLint matSpecularLoc = glGetUniformLocation(shader->program, "material.specular");
-    GLint matShineLoc = glGetUniformLocation(shader->program, "material.shininess");
-    GLuint modelLoc = glGetUniformLocation(shader->program, "model");
-    GLint normalMatrixLoc = glGetUniformLocation(shader->program, "normalMatrix");
+    return 60;
+}
+
+// bake the rock into its chunk's static geometry
+bool Rock::bake(ChunkBatch& batch)
+{
+    if (vertices.empty())
+    {
+        Random random(seed);
+        generateGeometry(random);
+    }
     
-    glUniform3f(matAmbientLoc, material.ambient.x, material.ambient.y, material.ambient.z);
-    glUniform3f(matDiffuseLoc, material.diffuse.x, material.diffuse.y, material.diffuse.z);
-    glUniform3f(matSpecularLoc, material.specular.x, material.specular.y, material.specular.z);
-    glUniform1f(matShineLoc, material.shininess);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(model));
     
+    BatchVertex vertex;
+    vertex.material = material.index;
     
-    //GLuint viewLoc = glGetUniformLocation(shader->program, "view");
-    //GLuint projectionLoc = glGetUniformLocation(shader->program, "projection");
+    // rocks don't sway
+    vertex.swayAxis = glm::vec3(0.0f);
+    vertex.swayParams = glm::vec3(0.0f);
     
+    // vertices are stored as position, normal pairs
+    for (int i = 0; i < vertices.size(); i += 2)
+    {
+        vertex.position = glm::vec3(model * glm::vec4(vertices[i], 1.0f));
+        vertex.normal = glm::normalize(normalMatrix * vertices[i + 1]);
+        batch.addVertex(vertex);
+    }
     
-    //glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    //glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    // the batch has its own copy now
+    releaseGeometry();
     
-    // Draw object
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 60);
-    glBindVertexArray(0);
+    return true;
 }
@@ -2,6 +2,7 @@
 
 #include <GLM\gtc\type_ptr.hpp>
 #include "Renderable.h"
+#include "Random.h"
 
 
 
@@ -9,13 +10,23 @@ class Rock : public Renderable
 {
     public:
     
-    Rock(glm::vec3 position);
+    Rock(glm::vec3 position, uint64_t seed);
 
     glm::vec3 calculateNormal(glm::vec3 point1, glm::vec3 point2, glm::vec3 point3);
     
-    void render(Shader* shader);
+    GLsizei drawCount();
     
     bool load();
     void unload();
     
+    bool bake(ChunkBatch& batch);
+    
+    private:
+    
+    // seed the rock was made from, the geometry is rebuilt from it after being released
+    uint64_t seed;
+    
+    // fill vertices, uses the first draws of the rock's random stream
+    void generateGeometry(Random& random);
+    
 };
\ No newline at end of file
@@ -9,18 +9,26 @@
 #include <GLFW\glfw3.h>
 #include "Renderable.h"
 #include "Shader.h"
+#include "MeshArchive.h"
+#include "Random.h"
 
 class Seaweed : public Renderable
 {
 public:
 
 	//Non-default constructor
-	Seaweed(glm::vec3 position);
+	Seaweed(glm::vec3 position, uint64_t seed);
 	//rotation angle
-	//Seaweed's render function
-	void render(Shader* shader);
+	//Vertices of the seaweed's mesh
+	GLsizei drawCount();
 
 	void animate(float deltaTime);
+
+	//Sphere around the mesh wherever the sway or the strand bends it
+	Bounds getBounds();
+
+	//Adds the seaweed as an instance of its shared mesh
+	bool bake(ChunkBatch& batch);
 	//The seaweed's position used in the animate function
 	glm::vec3 positionSeaweed;
 
@@ -40,15 +48,12 @@ public:
 	//Added for now to generate different seaweed
 	static int amount;
 
-	//Static VBOs and VAOs
-	static GLfloat greenVBO[];
-	static GLfloat redVBO[];
+	//Simulate seaweed as particle strands (StrandBatch) instead of shearing the mesh
+	static bool strands;
 
-	static GLuint gVAO;
-	static GLuint gVBO;
-
-	static GLuint rVAO;
-	static GLuint rVBO;
+	//Shared meshes, loaded from the mesh archive on first use
+	static Mesh greenMesh;
+	static Mesh redMesh;
 
 	//variables used for the animate function
 	GLfloat totalTime = 0.0f;
@@ -60,4 +65,11 @@ protected:
 	GLfloat scaleRand;
 	GLfloat xScaleRand;
 	GLfloat yScaleRand;
+
+	//Translation and rotations applied after the shear
+	glm::mat4 getBaseModel();
+	//Scale applied before the shear
+	glm::vec3 getMeshScale();
+	//Direction of the mesh from root to tip, in mesh space
+	glm::vec3 getMeshAxis();
 };
\ No newline at end of file
@@ -6,10 +6,30 @@
 
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include <GL\glew.h>
+#include <GLM\glm.hpp>
+#include <GLM\gtc\type_ptr.hpp>
 
 
+// Typed handle to a uniform, keep it around (static or member) and pass it to Shader::set
+// the name is only looked up again when the handle is used with another shader
+template<typename T>
+struct Uniform
+{
+	Uniform(std::string name) : name(name) {}
+
+	std::string name;
+
+	// Shader program the handle was last used with, and the uniform's slot in its table
+	GLuint program = 0;
+	int slot = -1;
+};
+
 
 class Shader 
 {
@@ -119,6 +139,95 @@ public:
 		glDeleteShader(vertex);
 		glDeleteShader(fragment);
 
+		// 4. Table of the active uniforms, so locations are never asked to the driver again
+		reflectUniforms();
+	}
+
+	// Compute shader, needs a GL 4.3 context
+	Shader(const GLchar* computePath)
+	{
+		std::string computeCode;
+		std::ifstream cShaderFile;
+		cShaderFile.exceptions(std::ifstream::badbit);
+
+		try
+		{
+			cShaderFile.open(computePath);
+			std::stringstream cShaderStream;
+			cShaderStream << cShaderFile.rdbuf();
+			cShaderFile.close();
+			computeCode = cShaderStream.str();
+		}
+		catch (std::ifstream::failure e)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+		}
+
+		const GLchar* cShaderCode = computeCode.c_str();
+		GLint success;
+		GLchar infoLog[512];
+
+		GLuint compute = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(compute, 1, &cShaderCode, NULL);
+		glCompileShader(compute);
+
+		glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+
+		if (!success)
+		{
+			glGetShaderInfoLog(compute, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+			std::cout << "In Compute Shader: " << computePath << std::endl;
+		}
+
+		this->program = glCreateProgram();
+		glAttachShader(this->program, compute);
+		glLinkProgram(this->program);
+
+		glGetProgramiv(this->program, GL_LINK_STATUS, &success);
+
+		if (!success)
+		{
+			glGetProgramInfoLog(this->program, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+			std::cout << "In Compute Shader: " << computePath << std::endl;
+		}
+
+		glDeleteShader(compute);
+
+		reflectUniforms();
+	}
+
+
+	// Send a value to a uniform of this shader, the shader has to be in use
+	// nothing is sent if the uniform already holds the value or isn't active
+	// the value is converted to the handle's type, ie a double can go to a float uniform
+	template<typename T>
+	void set(Uniform<T>& uniform, const typename std::common_type<T>::type& value)
+	{
+		static_assert(sizeof(T) <= sizeof(UniformSlot::value), "uniform type too large");
+
+		if (uniform.program != program)
+		{
+			auto found = slotNames.find(uniform.name);
+			uniform.slot = found == slotNames.end() ? -1 : found->second;
+			uniform.program = program;
+		}
+
+		if (uniform.slot < 0)
+		{
+			return;
+		}
+
+		UniformSlot& slot = slots[uniform.slot];
+		if (slot.known && std::memcmp(slot.value, &value, sizeof(T)) == 0)
+		{
+			return;
+		}
+
+		std::memcpy(slot.value, &value, sizeof(T));
+		slot.known = true;
+		upload(slot.location, value);
 	}
 
 
@@ -128,4 +237,61 @@ public:
 		glUseProgram(this->program);
 	}
 
+private:
+
+	// Active uniform, with the last value sent to it
+	struct UniformSlot
+	{
+		GLint location = -1;
+		bool known = false;
+		unsigned char value[sizeof(glm::mat4)];
+	};
+
+	std::vector<UniformSlot> slots;
+	std::unordered_map<std::string, int> slotNames;
+
+	// Fill the uniform table from the linked program
+	void reflectUniforms()
+	{
+		GLint uniformCount = 0;
+		glGetProgramiv(this->program, GL_ACTIVE_UNIFORMS, &uniformCount);
+		for (GLint i = 0; i < uniformCount; i++)
+		{
+			GLchar name[256];
+			GLsizei length;
+			GLint size;
+			GLenum type;
+			glGetActiveUniform(this->program, i, sizeof(name), &length, &size, &type, name);
+
+			UniformSlot slot;
+			slot.location = glGetUniformLocation(this->program, name);
+
+			// Members of uniform blocks have no location, they are set through buffers
+			if (slot.location < 0)
+			{
+				continue;
+			}
+
+			slotNames[name] = slots.size();
+
+			// Arrays are reported as their first element, make them reachable by their name too
+			std::string arrayName(name, length);
+			if (arrayName.size() > 3 && arrayName.compare(arrayName.size() - 3, 3, "[0]") == 0)
+			{
+				slotNames[arrayName.substr(0, arrayName.size() - 3)] = slots.size();
+			}
+
+			slots.push_back(slot);
+		}
+	}
+
+	static void upload(GLint location, int value) { glUniform1i(location, value); }
+	static void upload(GLint location, float value) { glUniform1f(location, value); }
+	static void upload(GLint location, const glm::vec2& value) { glUniform2fv(location, 1, glm::value_ptr(value)); }
+	static void upload(GLint location, const glm::vec3& value) { glUniform3fv(location, 1, glm::value_ptr(value)); }
+	static void upload(GLint location, const glm::vec4& value) { glUniform4fv(location, 1, glm::value_ptr(value)); }
+	static void upload(GLint location, const glm::ivec3& value) { glUniform3i(location, value.x, value.y, value.z); }
+	static void upload(GLint location, const glm::mat3& value) { glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+	static void upload(GLint location, const glm::mat4& value) { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+
 };
\ No newline at end of file
@@ -81,7 +81,8 @@ Skybox::Skybox()
 void Skybox::render(Shader* shader) const
 {
 	// Setup skybox uniform
-    glUniform1i(glGetUniformLocation(shader->program, "skyboxTexture"), 1);
+    static Uniform<int> textureUniform("skyboxTexture");
+    shader->set(textureUniform, 1);
     
 	//Disable depth mask for skybox rendering
 	glDepthMask(GL_FALSE);
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//handle to an element of a SlotMap
+//the slot's generation changes every time it is freed, so handles to removed elements are detected
+struct SlotHandle
+{
+    uint32_t index = 0xFFFFFFFF;
+    uint32_t generation = 0;
+
+    bool operator==(const SlotHandle& other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+};
+
+//generational slot map, maps stable handles to indices in packed arrays
+//the owner keeps one dense array per component and mirrors the moves reported by erase,
+//so spawn and despawn are O(1) and systems iterate over contiguous memory
+class SlotMap
+{
+    public:
+
+    //new element, its dense index is size() - 1
+    SlotHandle insert()
+    {
+        uint32_t slot;
+        if(freeSlots.empty())
+        {
+            slot = (uint32_t)slots.size();
+            slots.push_back(Slot());
+        }
+        else
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+
+        slots[slot].dense = (uint32_t)dense.size();
+        dense.push_back(slot);
+
+        SlotHandle handle;
+        handle.index = slot;
+        handle.generation = slots[slot].generation;
+        return handle;
+    }
+
+    //remove an element, the last element takes its place
+    //returns the dense index that was freed (the caller moves its last array elements there), -1 for a stale handle
+    int erase(SlotHandle handle)
+    {
+        if(!contains(handle))
+        {
+            return -1;
+        }
+
+        uint32_t index = slots[handle.index].dense;
+        uint32_t last = dense.back();
+
+        dense[index] = last;
+        slots[last].dense = index;
+        dense.pop_back();
+
+        slots[handle.index].generation++;
+        freeSlots.push_back(handle.index);
+
+        return (int)index;
+    }
+
+    bool contains(SlotHandle handle) const
+    {
+        return handle.index < slots.size() && slots[handle.index].generation == handle.generation;
+    }
+
+    //dense index of a handle, -1 for a stale handle
+    int indexOf(SlotHandle handle) const
+    {
+        return contains(handle) ? (int)slots[handle.index].dense : -1;
+    }
+
+    //handle of the element at a dense index
+    SlotHandle handleAt(int index) const
+    {
+        SlotHandle handle;
+        handle.index = dense[index];
+        handle.generation = slots[dense[index]].generation;
+        return handle;
+    }
+
+    int size() const
+    {
+        return (int)dense.size();
+    }
+
+    private:
+
+    struct Slot
+    {
+        uint32_t dense = 0;
+        uint32_t generation = 0;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+
+    //slot of every dense index
+    std::vector<uint32_t> dense;
+};
+
+//mirror SlotMap::erase on a packed component array
+template<typename T>
+void swapRemove(std::vector<T>& components, int index)
+{
+    components[index] = std::move(components.back());
+    components.pop_back();
+}
@@ -0,0 +1,226 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpatialGrid::SpatialGrid(float worldSize, float cellSize) : worldSize(worldSize), cellSize(cellSize)
+{
+    cells = std::max(1, (int)std::ceil(worldSize / cellSize));
+    buckets.resize(cells * cells);
+}
+
+int SpatialGrid::cellOf(float value)
+{
+    int cell = (int)std::floor(value / cellSize);
+    return std::min(std::max(cell, 0), cells - 1);
+}
+
+void SpatialGrid::cellRange(glm::vec2 min, glm::vec2 max, int& minX, int& minZ, int& maxX, int& maxZ)
+{
+    minX = cellOf(min.x - maxRadius);
+    minZ = cellOf(min.y - maxRadius);
+    maxX = cellOf(max.x + maxRadius);
+    maxZ = cellOf(max.y + maxRadius);
+}
+
+void SpatialGrid::insert(const SpatialEntry& entry)
+{
+    buckets[cellOf(entry.center.x) * cells + cellOf(entry.center.z)].push_back(entry);
+    maxRadius = std::max(maxRadius, entry.radius);
+    count++;
+}
+
+void SpatialGrid::remove(Renderable* owner, glm::vec3 center)
+{
+    auto& bucket = buckets[cellOf(center.x) * cells + cellOf(center.z)];
+    for(int i = 0; i < bucket.size(); i++)
+    {
+        if(bucket[i].owner == owner)
+        {
+            bucket[i] = bucket.back();
+            bucket.pop_back();
+            count--;
+            return;
+        }
+    }
+}
+
+void SpatialGrid::clear()
+{
+    for(auto& bucket : buckets)
+    {
+        bucket.clear();
+    }
+    maxRadius = 0.0f;
+    count = 0;
+}
+
+bool SpatialGrid::containsPoint(glm::vec3 point)
+{
+    return overlapsSphere(point, 0.0f);
+}
+
+bool SpatialGrid::overlapsSphere(glm::vec3 center, float radius)
+{
+    int minX, minZ, maxX, maxZ;
+    cellRange(glm::vec2(center.x - radius, center.z - radius), glm::vec2(center.x + radius, center.z + radius), minX, minZ, maxX, maxZ);
+
+    for(int x = minX; x <= maxX; x++)
+    {
+        for(int z = minZ; z <= maxZ; z++)
+        {
+            for(auto& entry : buckets[x * cells + z])
+            {
+                float reach = entry.radius + radius;
+                glm::vec3 delta = entry.center - center;
+                if(glm::dot(delta, delta) < reach * reach)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void SpatialGrid::sweepRange(glm::vec3 start, glm::vec3 end, float radius, int& minX, int& minZ, int& maxX, int& maxZ)
+{
+    cellRange(glm::vec2(std::min(start.x, end.x) - radius, std::min(start.z, end.z) - radius),
+              glm::vec2(std::max(start.x, end.x) + radius, std::max(start.z, end.z) + radius),
+              minX, minZ, maxX, maxZ);
+}
+
+bool SpatialGrid::sweepEntry(const SpatialEntry& entry, glm::vec3 start, glm::vec3 direction, float radius, float& s)
+{
+    //solve |start + s * direction - center| = reach for the first s
+    float reach = entry.radius + radius;
+    glm::vec3 offset = start - entry.center;
+    float c = glm::dot(offset, offset) - reach * reach;
+
+    if(c < 0.0f)
+    {
+        //already overlapping at the start
+        s = 0.0f;
+        return true;
+    }
+
+    float a = glm::dot(direction, direction);
+    float b = glm::dot(offset, direction);
+    float discriminant = b * b - a * c;
+    if(a == 0.0f || b >= 0.0f || discriminant < 0.0f)
+    {
+        return false;
+    }
+    s = (-b - std::sqrt(discriminant)) / a;
+    return s <= 1.0f;
+}
+
+bool SpatialGrid::sweepSphere(glm::vec3 start, glm::vec3 end, float radius, float& t, SpatialEntry* hit)
+{
+    int minX, minZ, maxX, maxZ;
+    sweepRange(start, end, radius, minX, minZ, maxX, maxZ);
+
+    bool found = false;
+    t = 1.0f;
+
+    for(int x = minX; x <= maxX; x++)
+    {
+        for(int z = minZ; z <= maxZ; z++)
+        {
+            for(auto& entry : buckets[x * cells + z])
+            {
+                float s;
+                if(sweepEntry(entry, start, end - start, radius, s) && s <= t)
+                {
+                    t = s;
+                    found = true;
+                    if(hit != nullptr)
+                    {
+                        *hit = entry;
+                    }
+                }
+            }
+        }
+    }
+    return found;
+}
+
+void SpatialGrid::sweepAll(glm::vec3 start, glm::vec3 end, float radius, std::vector<SpatialEntry>& result)
+{
+    result.clear();
+
+    int minX, minZ, maxX, maxZ;
+    sweepRange(start, end, radius, minX, minZ, maxX, maxZ);
+
+    for(int x = minX; x <= maxX; x++)
+    {
+        for(int z = minZ; z <= maxZ; z++)
+        {
+            for(auto& entry : buckets[x * cells + z])
+            {
+                float s;
+                if(sweepEntry(entry, start, end - start, radius, s))
+                {
+                    result.push_back(entry);
+                }
+            }
+        }
+    }
+}
+
+void SpatialGrid::nearest(glm::vec3 point, int k, std::vector<SpatialEntry>& result)
+{
+    result.clear();
+    if(k <= 0 || count == 0)
+    {
+        return;
+    }
+
+    auto distance = [point](const SpatialEntry& entry)
+    {
+        glm::vec3 delta = entry.center - point;
+        return glm::dot(delta, delta);
+    };
+
+    //grow a square around the point until it holds k centers closer than its half size
+    for(float range = cellSize; ; range *= 2.0f)
+    {
+        int minX = cellOf(point.x - range);
+        int minZ = cellOf(point.z - range);
+        int maxX = cellOf(point.x + range);
+        int maxZ = cellOf(point.z + range);
+
+        result.clear();
+        for(int x = minX; x <= maxX; x++)
+        {
+            for(int z = minZ; z <= maxZ; z++)
+            {
+                for(auto& entry : buckets[x * cells + z])
+                {
+                    result.push_back(entry);
+                }
+            }
+        }
+
+        std::sort(result.begin(), result.end(), [&distance](const SpatialEntry& a, const SpatialEntry& b)
+        {
+            return distance(a) < distance(b);
+        });
+
+        bool coversWorld = minX == 0 && minZ == 0 && maxX == cells - 1 && maxZ == cells - 1;
+        if(coversWorld || (result.size() >= k && distance(result[k - 1]) <= range * range))
+        {
+            break;
+        }
+    }
+
+    if(result.size() > k)
+    {
+        result.resize(k);
+    }
+}
+
+int SpatialGrid::getCount()
+{
+    return count;
+}
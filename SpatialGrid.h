@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <GLM\glm.hpp>
+
+class Renderable;
+
+//sphere stored in a SpatialGrid
+struct SpatialEntry
+{
+    glm::vec3 center;
+    float radius;
+    Renderable* owner = nullptr;
+    //index in the owner's packed arrays, for entries that aren't renderables
+    int index = -1;
+};
+
+//world space index of bounding spheres on the x/z plane
+//every sphere lives in the cell holding its center (loose grid), queries look
+//around the position as far as the largest radius inserted, so chunk borders don't matter
+class SpatialGrid
+{
+    public:
+    //grid covering [0, worldSize] on x and z
+    SpatialGrid(float worldSize, float cellSize);
+
+    void insert(const SpatialEntry& entry);
+    //remove the sphere of an owner, center is the one it was inserted with
+    void remove(Renderable* owner, glm::vec3 center);
+    //remove every sphere, for indices rebuilt each frame
+    void clear();
+
+    //true if the point is inside a sphere
+    bool containsPoint(glm::vec3 point);
+    //true if the sphere overlaps a sphere
+    bool overlapsSphere(glm::vec3 center, float radius);
+
+    //move a sphere from start to end, returns true if it hits something on the way
+    //t is set to the fraction of the path travelled before the first hit
+    bool sweepSphere(glm::vec3 start, glm::vec3 end, float radius, float& t, SpatialEntry* hit = nullptr);
+    //every sphere a sphere moving from start to end touches, in no particular order
+    void sweepAll(glm::vec3 start, glm::vec3 end, float radius, std::vector<SpatialEntry>& result);
+
+    //the k spheres with the closest centers, closest first
+    void nearest(glm::vec3 point, int k, std::vector<SpatialEntry>& result);
+
+    int getCount();
+
+    private:
+    float worldSize;
+    float cellSize;
+    int cells;
+
+    //largest radius inserted, how far from its cell a sphere can reach
+    float maxRadius = 0.0f;
+    int count = 0;
+
+    std::vector<std::vector<SpatialEntry>> buckets;
+
+    int cellOf(float value);
+    //range of cells holding spheres that can reach the box [min, max]
+    void cellRange(glm::vec2 min, glm::vec2 max, int& minX, int& minZ, int& maxX, int& maxZ);
+    //cells a moving sphere can touch
+    void sweepRange(glm::vec3 start, glm::vec3 end, float radius, int& minX, int& minZ, int& maxX, int& maxZ);
+    //fraction s of the path where a moving sphere first touches an entry, false if it never does
+    static bool sweepEntry(const SpatialEntry& entry, glm::vec3 start, glm::vec3 direction, float radius, float& s);
+};
@@ -0,0 +1,251 @@
+#include "StrandBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+float StrandBatch::buoyancy = 6.0f;
+float StrandBatch::damping = 0.96f;
+
+Uniform<glm::vec3> StrandBatch::axisUniform("strandAxis");
+Uniform<glm::vec2> StrandBatch::rangeUniform("strandRange");
+
+void StrandBatch::add(const Mesh* mesh, glm::vec3 axis, const BatchInstance& instance, float drag)
+{
+    //find the group for this mesh, create it if needed
+    StrandGroup* group = nullptr;
+    for(auto& existing : groups)
+    {
+        if(existing.mesh == mesh)
+        {
+            group = &existing;
+        }
+    }
+    if(group == nullptr)
+    {
+        groups.push_back(StrandGroup());
+        group = &groups.back();
+        group->mesh = mesh;
+        group->axis = axis;
+        group->rangeMin = glm::dot(mesh->boundsMin, axis);
+        group->rangeMax = glm::dot(mesh->boundsMax, axis);
+    }
+
+    //ends of the mesh along the axis in world space
+    glm::vec3 root = glm::vec3(instance.model * glm::vec4(instance.scale * axis * group->rangeMin, 1.0f));
+    glm::vec3 tip = glm::vec3(instance.model * glm::vec4(instance.scale * axis * group->rangeMax, 1.0f));
+    float length = glm::length(tip - root);
+    glm::vec3 rest = (tip - root) / length;
+
+    //keep the arrays a multiple of four long, padding strands have no length and never move
+    int index = group->count++;
+    int padded = (group->count + 3) & ~3;
+    if((int)group->rootX.size() < padded)
+    {
+        for(auto array : {&group->rootX, &group->rootY, &group->rootZ, &group->restX, &group->restY, &group->restZ, &group->segment, &group->drag, &group->currentX, &group->currentZ})
+        {
+            array->resize(padded, 0.0f);
+        }
+        for(int k = 0; k < particles; k++)
+        {
+            for(auto array : {&group->x[k], &group->y[k], &group->z[k], &group->oldX[k], &group->oldY[k], &group->oldZ[k]})
+            {
+                array->resize(padded, 0.0f);
+            }
+        }
+    }
+
+    group->rootX[index] = root.x;
+    group->rootY[index] = root.y;
+    group->rootZ[index] = root.z;
+    group->restX[index] = rest.x;
+    group->restY[index] = rest.y;
+    group->restZ[index] = rest.z;
+    group->segment[index] = length / particles;
+    group->drag[index] = drag;
+
+    //start at rest
+    for(int k = 0; k < particles; k++)
+    {
+        glm::vec3 position = root + rest * (length * (k + 1) / particles);
+        group->x[k][index] = group->oldX[k][index] = position.x;
+        group->y[k][index] = group->oldY[k][index] = position.y;
+        group->z[k][index] = group->oldZ[k][index] = position.z;
+    }
+
+    group->instances.push_back(instance);
+}
+
+void StrandBatch::upload()
+{
+    for(auto& group : groups)
+    {
+        group.offsets.assign(group.count * particles, glm::vec3(0.0f));
+
+        glGenVertexArrays(1, &group.VAO);
+        glGenBuffers(1, &group.instanceVBO);
+        glGenBuffers(1, &group.offsetVBO);
+
+        glBindVertexArray(group.VAO);
+
+        // Shared mesh, one vertex per draw vertex
+        group.mesh->bindAttributes();
+
+        // Instance data, placed once
+        glBindBuffer(GL_ARRAY_BUFFER, group.instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(BatchInstance) * group.instances.size(), group.instances.data(), GL_STATIC_DRAW);
+        ChunkBatch::bindInstanceAttributes();
+
+        // Particle offsets, rewritten every frame
+        glBindBuffer(GL_ARRAY_BUFFER, group.offsetVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * group.offsets.size(), NULL, GL_STREAM_DRAW);
+        for(int k = 0; k < particles; k++)
+        {
+            glVertexAttribPointer(12 + k, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3) * particles, (GLvoid*)(k * sizeof(glm::vec3)));
+            glEnableVertexAttribArray(12 + k);
+            glVertexAttribDivisor(12 + k, 1);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+
+        std::vector<BatchInstance>().swap(group.instances);
+    }
+}
+
+void StrandBatch::clear()
+{
+    for(auto& group : groups)
+    {
+        glDeleteBuffers(1, &group.instanceVBO);
+        glDeleteBuffers(1, &group.offsetVBO);
+        glDeleteVertexArrays(1, &group.VAO);
+    }
+    groups.clear();
+}
+
+void StrandBatch::simulate(float deltaTime, OceanCurrent* current)
+{
+    //long frames would make the chains explode
+    deltaTime = std::min(deltaTime, 1.0f / 30.0f);
+
+    for(auto& group : groups)
+    {
+        simulateGroup(group, deltaTime, current);
+    }
+}
+
+void StrandBatch::simulateGroup(StrandGroup& group, float deltaTime, OceanCurrent* current)
+{
+    //the flow is read once per strand, the particles are close enough to share it
+    for(int i = 0; i < group.count; i++)
+    {
+        glm::vec3 flow = current->sample(glm::vec3(group.rootX[i], group.rootY[i], group.rootZ[i]));
+        group.currentX[i] = flow.x;
+        group.currentZ[i] = flow.z;
+    }
+
+    const __m128 step = _mm_set1_ps(deltaTime * deltaTime);
+    const __m128 keep = _mm_set1_ps(damping);
+    const __m128 lift = _mm_set1_ps(buoyancy);
+    const __m128 epsilon = _mm_set1_ps(1e-6f);
+
+    int padded = group.rootX.size();
+    for(int i = 0; i < padded; i += 4)
+    {
+        __m128 drag = _mm_loadu_ps(&group.drag[i]);
+        __m128 segment = _mm_loadu_ps(&group.segment[i]);
+
+        //acceleration is the same for every particle of a strand
+        __m128 accelX = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&group.currentX[i]), drag), step);
+        __m128 accelY = _mm_mul_ps(lift, step);
+        __m128 accelZ = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&group.currentZ[i]), drag), step);
+
+        //each particle follows the one before it, starting from the root
+        __m128 parentX = _mm_loadu_ps(&group.rootX[i]);
+        __m128 parentY = _mm_loadu_ps(&group.rootY[i]);
+        __m128 parentZ = _mm_loadu_ps(&group.rootZ[i]);
+
+        for(int k = 0; k < particles; k++)
+        {
+            __m128 x = _mm_loadu_ps(&group.x[k][i]);
+            __m128 y = _mm_loadu_ps(&group.y[k][i]);
+            __m128 z = _mm_loadu_ps(&group.z[k][i]);
+
+            //verlet, x + (x - old) * damping + a * dt^2
+            __m128 newX = _mm_add_ps(_mm_add_ps(x, _mm_mul_ps(_mm_sub_ps(x, _mm_loadu_ps(&group.oldX[k][i])), keep)), accelX);
+            __m128 newY = _mm_add_ps(_mm_add_ps(y, _mm_mul_ps(_mm_sub_ps(y, _mm_loadu_ps(&group.oldY[k][i])), keep)), accelY);
+            __m128 newZ = _mm_add_ps(_mm_add_ps(z, _mm_mul_ps(_mm_sub_ps(z, _mm_loadu_ps(&group.oldZ[k][i])), keep)), accelZ);
+
+            _mm_storeu_ps(&group.oldX[k][i], x);
+            _mm_storeu_ps(&group.oldY[k][i], y);
+            _mm_storeu_ps(&group.oldZ[k][i], z);
+
+            //length constraint, put the particle back at one segment from its parent
+            __m128 dx = _mm_sub_ps(newX, parentX);
+            __m128 dy = _mm_sub_ps(newY, parentY);
+            __m128 dz = _mm_sub_ps(newZ, parentZ);
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_add_ps(_mm_mul_ps(dz, dz), epsilon)));
+            __m128 scale = _mm_div_ps(segment, length);
+
+            parentX = _mm_add_ps(parentX, _mm_mul_ps(dx, scale));
+            parentY = _mm_add_ps(parentY, _mm_mul_ps(dy, scale));
+            parentZ = _mm_add_ps(parentZ, _mm_mul_ps(dz, scale));
+
+            _mm_storeu_ps(&group.x[k][i], parentX);
+            _mm_storeu_ps(&group.y[k][i], parentY);
+            _mm_storeu_ps(&group.z[k][i], parentZ);
+        }
+    }
+
+    //offsets from the rest pose for the shader
+    for(int i = 0; i < group.count; i++)
+    {
+        for(int k = 0; k < particles; k++)
+        {
+            float distance = group.segment[i] * (k + 1);
+            glm::vec3& offset = group.offsets[i * particles + k];
+            offset.x = group.x[k][i] - (group.rootX[i] + group.restX[i] * distance);
+            offset.y = group.y[k][i] - (group.rootY[i] + group.restY[i] * distance);
+            offset.z = group.z[k][i] - (group.rootZ[i] + group.restZ[i] * distance);
+        }
+    }
+}
+
+void StrandBatch::simulateAll(std::vector<StrandBatch*>& batches, float deltaTime, OceanCurrent* current, WorkerPool& pool)
+{
+    //chunks don't share strands, each is one job
+    pool.parallelFor(batches.size(), [&batches, deltaTime, current](int index)
+    {
+        batches[index]->simulate(deltaTime, current);
+    });
+}
+
+void StrandBatch::submit(RenderQueue& queue, Shader* shader, glm::vec3 center)
+{
+    for(auto& group : groups)
+    {
+        //orphan last frame's offsets instead of waiting for the gpu to finish with them
+        glBindBuffer(GL_ARRAY_BUFFER, group.offsetVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * group.offsets.size(), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * group.offsets.size(), group.offsets.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        DrawPacket packet;
+        packet.shader = shader;
+        packet.VAO = group.VAO;
+        packet.count = group.mesh->vertexCount;
+        packet.instances = group.count;
+        packet.apply = applyGroup;
+        packet.owner = &group;
+        queue.submit(PASS_OPAQUE, packet, 0, center);
+    }
+}
+
+void StrandBatch::applyGroup(Shader* shader, void* owner)
+{
+    StrandGroup* group = (StrandGroup*)owner;
+    shader->set(ChunkBatch::batchModeUniform, 3);
+    shader->set(axisUniform, group->axis);
+    shader->set(rangeUniform, glm::vec2(group->rangeMin, group->rangeMax));
+}
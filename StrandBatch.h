@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include <GL\glew.h>
+#include <GLM\glm.hpp>
+
+#include "ChunkBatch.h"
+#include "OceanCurrent.h"
+#include "WorkerPool.h"
+
+//seaweed of a chunk simulated as chains of particles instead of a swaying rigid mesh
+//every strand is a fixed root and three particles moved by verlet integration, buoyancy
+//and the current, then pulled back to their segment length
+//particles are stored as one array per coordinate so four strands are stepped at once with sse,
+//the shader bends the shared mesh along the chain (batchMode 3, see mainlit.vs)
+class StrandBatch
+{
+    public:
+
+    //particles after the root
+    static const int particles = 3;
+
+    //upward acceleration keeping strands standing
+    static float buoyancy;
+    //fraction of the velocity kept every step
+    static float damping;
+
+    //add a strand bending the shared mesh along axis (mesh space, from the root to the tip)
+    //drag scales how much the current pushes it
+    void add(const Mesh* mesh, glm::vec3 axis, const BatchInstance& instance, float drag);
+
+    //create the gpu buffers
+    void upload();
+
+    //free the gpu buffers and every strand
+    void clear();
+
+    //step every strand, each is pushed by the flow at its root
+    void simulate(float deltaTime, OceanCurrent* current);
+
+    //simulate the strands of many chunks, one job per chunk on pool
+    static void simulateAll(std::vector<StrandBatch*>& batches, float deltaTime, OceanCurrent* current, WorkerPool& pool);
+
+    //send this frame's offsets and queue one instanced draw for the strands of every mesh
+    void submit(RenderQueue& queue, Shader* shader, glm::vec3 center);
+
+    private:
+
+    //all strands sharing one mesh
+    struct StrandGroup
+    {
+        const Mesh* mesh;
+        glm::vec3 axis;
+        //extent of the mesh along axis
+        float rangeMin;
+        float rangeMax;
+
+        std::vector<BatchInstance> instances;
+        int count = 0;
+
+        //one element per strand, padded to a multiple of four
+        std::vector<float> rootX, rootY, rootZ;
+        //direction of the strand at rest
+        std::vector<float> restX, restY, restZ;
+        std::vector<float> segment;
+        std::vector<float> drag;
+        //flow at the root, sampled every step
+        std::vector<float> currentX, currentZ;
+
+        //current and previous position of every particle
+        std::vector<float> x[particles], y[particles], z[particles];
+        std::vector<float> oldX[particles], oldY[particles], oldZ[particles];
+
+        //offset of every particle from its rest position, sent to the shader each frame
+        std::vector<glm::vec3> offsets;
+
+        GLuint VAO = 0;
+        GLuint instanceVBO = 0;
+        GLuint offsetVBO = 0;
+    };
+
+    std::vector<StrandGroup> groups;
+
+    //direction of the strand in mesh space and the mesh's extent along it
+    static Uniform<glm::vec3> axisUniform;
+    static Uniform<glm::vec2> rangeUniform;
+
+    //step every strand of a group, four at a time
+    static void simulateGroup(StrandGroup& group, float deltaTime, OceanCurrent* current);
+
+    //uniforms of a group's draw (see DrawPacket::apply)
+    static void applyGroup(Shader* shader, void* owner);
+};
@@ -1,13 +1,14 @@
 #include "Terrain.h"
+#include "Coral.h"
+#include "IndirectBatch.h"
+#include <algorithm>
+#include <cmath>
 
-TerrainChunk::TerrainChunk(int size, int posX, int posY, float offset,  SimplexNoise* pn, int finalSize) : size(size), posX(posX), posY(posY)
+TerrainChunk::TerrainChunk(int size, int posX, int posY, float offset,  SimplexNoise* pn, int finalSize, uint64_t worldSeed) : size(size), entities(arena), posX(posX), posY(posY), seed(Random::derive(worldSeed, posX, posY)), placements(arena), corals(arena)
 {
     //create new heightmap
     heightMap = new float*[size];
     
-    //keep track of indices
-    int currentIndice = 0;
-    
     for(int x = 0; x < size; x++)
     {
         heightMap[x] = new float[size];
@@ -20,67 +21,185 @@ TerrainChunk::TerrainChunk(int size, int posX, int posY, float offset,  SimplexN
             float coordY = (posY * (size-1) + y);
             
             //generate height at coordinates
-            float height = 50 * pn->noise(coordX/(20*20), coordY/(20*20));
+            heightMap[x][y] = 50 * pn->noise(coordX/(20*20), coordY/(20*20));
+        }
+    }
+    
+    //Assign material
+    material = Material(glm::vec3(0.65f, 0.4f, 0.31f), glm::vec3(0.76f, 0.7f, 0.5f), glm::vec3(0.5f, 0.5f, 0.5f), 4.0f);
+    
+}
+
+glm::vec3 TerrainChunk::getPoint(int x, int y)
+{
+    return glm::vec3(posX * (size-1) + x, heightMap[x][y], posY * (size-1) + y);
+}
+
+void TerrainChunk::buildMesh()
+{
+    for(int x = 1; x < size; x++)
+    {
+        for(int y = 1; y < size; y++)
+        {
+            //triangle one
+            glm::vec3 t1v1 = getPoint(x, y);
+            glm::vec3 t1v2 = getPoint(x, y-1);
+            glm::vec3 t1v3 = getPoint(x-1, y-1);
+            
+            //triangle two
+            glm::vec3 t2v1 = getPoint(x, y);
+            glm::vec3 t2v2 = getPoint(x-1, y);
+            glm::vec3 t2v3 = getPoint(x-1, y-1);
             
-            heightMap[x][y] = height;
+            //edges
+            glm::vec3 t1e1 = t1v2-t1v1;
+            glm::vec3 t1e2 = t1v3-t1v1;
             
-            //std::cout << height << std::endl;
+            glm::vec3 t2e1 = t2v2-t2v1;
+            glm::vec3 t2e2 = t2v3-t2v1;
             
-            vertices.push_back({coordX, height, coordY });
+            //normals
+            glm::vec3 t1n = glm::normalize(glm::cross(t1e1,t1e2));
+            glm::vec3 t2n = glm::normalize(glm::cross(t2e2,t2e1));
             
-            //add triangles to vertice list in order to render terrain alter
-            if(x > 0 && y > 0)
+            //store data
+            finalVertices.push_back(t1v1);
+            finalVertices.push_back(t1n);
+            finalVertices.push_back(t1v2);
+            finalVertices.push_back(t1n);
+            finalVertices.push_back(t1v3);
+            finalVertices.push_back(t1n);
+            
+            finalVertices.push_back(t2v1);
+            finalVertices.push_back(t2n);
+            finalVertices.push_back(t2v2);
+            finalVertices.push_back(t2n);
+            finalVertices.push_back(t2v3);
+            finalVertices.push_back(t2n);
+        }
+    }
+}
+
+void TerrainChunk::addEntity(Renderable* r)
+{
+    entities.push_back(r);
+    batchDirty = true;
+}
+
+void TerrainChunk::removeEntity(Renderable* r)
+{
+    auto it = std::find(entities.begin(), entities.end(), r);
+    if(it == entities.end())
+    {
+        return;
+    }
+    entities.erase(it);
+    
+    //entity was drawn on its own, free its buffers
+    auto unbaked = std::find(unbakedEntities.begin(), unbakedEntities.end(), r);
+    if(unbaked != unbakedEntities.end())
+    {
+        r->unload();
+        unbakedEntities.erase(unbaked);
+    }
+    
+    batchDirty = true;
+}
+
+void TerrainChunk::place(const PlacementRules& rules)
+{
+    glm::vec2 origin(posX * (size-1), posY * (size-1));
+    
+    ChunkPlacer placer(heightMap, size, origin, rules);
+    placer.place(seed, placements);
+}
+
+void TerrainChunk::spawnEntities()
+{
+    entities.reserve(entities.size() + placements.size());
+    
+    for(auto& placement : placements)
+    {
+        glm::vec3 position = placement.position;
+        
+        switch(placement.type)
+        {
+            case PLACEMENT_ROCK:
+                addEntity(arena.create<Rock>(-position, placement.seed));
+                break;
+            case PLACEMENT_CORAL:
             {
-                //triangle one
-                glm::vec3 t1v1 = vertices.at(currentIndice);
-                glm::vec3 t1v2 = vertices.at(currentIndice-1);
-                glm::vec3 t1v3 = vertices.at(currentIndice-size-1);
-                
-                //triangle two
-                glm::vec3 t2v1 = vertices.at(currentIndice);
-                glm::vec3 t2v2 = vertices.at(currentIndice-size);
-                glm::vec3 t2v3 = vertices.at(currentIndice-size-1);
-                
-                //edges
-                glm::vec3 t1e1 = t1v2-t1v1;
-                glm::vec3 t1e2 = t1v3-t1v1;
-                
-                glm::vec3 t2e1 = t2v2-t2v1;
-                glm::vec3 t2e2 = t2v3-t2v1;
-                
-                //normals
-                glm::vec3 t1n = glm::normalize(glm::cross(t1e1,t1e2));
-                glm::vec3 t2n = glm::normalize(glm::cross(t2e2,t2e1));
-                
-                //store data
-                finalVertices.push_back(t1v1);
-                finalVertices.push_back(t1n);
-                finalVertices.push_back(t1v2);
-                finalVertices.push_back(t1n);
-                finalVertices.push_back(t1v3);
-                finalVertices.push_back(t1n);
-                
-                finalVertices.push_back(t2v1);
-                finalVertices.push_back(t2n);
-                finalVertices.push_back(t2v2);
-                finalVertices.push_back(t2n);
-                finalVertices.push_back(t2v3);
-                finalVertices.push_back(t2n);
+                const CoralGrowth* growth = corals.size() < coralGrowth.size() ? &coralGrowth[corals.size()] : nullptr;
+                corals.push_back(arena.create<Coral>(-position, placement.seed, growth));
+                addEntity(corals.back());
+                break;
             }
-            
-            currentIndice++;
+            case PLACEMENT_SEAWEED:
+                addEntity(arena.create<Seaweed>(position + glm::vec3(0, 1, 0), placement.seed));
+                break;
         }
     }
-    vertices.clear();
+    placements.clear();
+    populated = true;
+}
+
+void TerrainChunk::depopulate()
+{
+    for(auto entity : unbakedEntities)
+    {
+        entity->unload();
+    }
+    unbakedEntities.clear();
     
-    //Assign material
-    material = Material(glm::vec3(0.65f, 0.4f, 0.31f), glm::vec3(0.76f, 0.7f, 0.5f), glm::vec3(0.5f, 0.5f, 0.5f), 4.0f);
+    coralGrowth.clear();
+    for(auto coral : corals)
+    {
+        coralGrowth.push_back(coral->getGrowth());
+    }
+    
+    //the vectors in the arena start over empty, clear() would keep their storage
+    placements = ArenaVector<Placement>(arena);
+    corals = ArenaVector<Coral*>(arena);
+    entities = ArenaVector<Renderable*>(arena);
+    arena.clear();
     
+    batch.clear();
+    batchDirty = true;
+    populated = false;
 }
 
-void TerrainChunk::addEntity(Renderable* r)
+bool TerrainChunk::isPopulated()
 {
-    entities.push_back(r);
+    return populated;
+}
+
+void TerrainChunk::bakeEntities()
+{
+    batch.clear();
+    unbakedEntities.clear();
+    batchBox = BoundingBox();
+    
+    for(auto entity : entities)
+    {
+        if(entity->bake(batch))
+        {
+            batchBox.add(entity->getBounds());
+        }
+        else
+        {
+            unbakedEntities.push_back(entity);
+        }
+    }
+    
+    batch.upload();
+    
+    //entities that can't be batched keep their own buffers
+    for(auto entity : unbakedEntities)
+    {
+        entity->load();
+    }
+    
+    batchDirty = false;
 }
 
 int TerrainChunk::getPosX()
@@ -94,6 +213,11 @@ int TerrainChunk::getPosY()
     return posY;
 }
 
+uint64_t TerrainChunk::getSeed()
+{
+    return seed;
+}
+
 float TerrainChunk::getHeightAt(int x, int y)
 {
     if(x < 0 || y < 0 || x >= size || y >= size)
@@ -112,37 +236,27 @@ void TerrainChunk::setHeightAt(int x, int y, float height)
     }
     
     heightMap[x][y] = height;
-    
+    groundMinimum.clear();
 }
-bool TerrainChunk::load()
+bool TerrainChunk::load(ChunkMeshBuffer& meshes)
 {
-    if(VAO == 0)
+    if(meshFirst < 0)
     {
+        //the mesh only lives on the gpu, rebuild it from the heightmap
+        buildMesh();
         
-        // Generate buffers
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        
-        // Buffer object data
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * finalVertices.size(), finalVertices.data(), GL_STATIC_DRAW);
-        
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
-        glEnableVertexAttribArray(0);
-        
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(1);
+        meshBox = BoundingBox();
+        for(int i = 0; i < finalVertices.size(); i += 2)
+        {
+            meshBox.add(finalVertices[i]);
+        }
         
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        meshFirst = meshes.allocate(finalVertices);
         
+        std::vector<glm::vec3>().swap(finalVertices);
         
-        //render all the entities contained in the chunk
-        for(auto entity : entities)
-        {
-            entity->load();
-        }
+        //bake static entities and load the others
+        bakeEntities();
         
         
         
@@ -151,65 +265,191 @@ bool TerrainChunk::load()
     return false;
 }
 
-void TerrainChunk::unload()
+void TerrainChunk::unload(ChunkMeshBuffer& meshes)
 {
     
-    //unload all the entities contained in the chunk
-    for(auto entity : entities)
+    //unload all the entities that were not baked
+    for(auto entity : unbakedEntities)
     {
         entity->unload();
     }
+    unbakedEntities.clear();
     
+    batch.clear();
+    batchDirty = true;
     
-    glDeleteBuffers(1, &VBO);
-    glDeleteVertexArrays(1, &VAO);
+    if(meshFirst >= 0)
+    {
+        meshes.release(meshFirst);
+        meshFirst = -1;
+    }
+}
+StrandBatch* TerrainChunk::getStrands()
+{
+    return batch.getStrands();
+}
+
+void TerrainChunk::grow(int& budget)
+{
+    batch.grow(budget);
+}
+
+void TerrainChunk::prepare(float deltaTime)
+{
+    //entities changed since the last bake
+    if(batchDirty && meshFirst >= 0)
+    {
+        bakeEntities();
+    }
+    
+    box = meshBox;
+    box.add(batchBox);
     
-    VBO = 0;
-    VAO = 0;
+    //the remaining entities move, their spheres are taken after they do
+    unbakedBounds.clear();
+    for(auto entity : unbakedEntities)
+    {
+        entity->animate(deltaTime);
+        unbakedBounds.push_back(entity->getBounds());
+        box.add(unbakedBounds.back());
+    }
 }
-void TerrainChunk::render(Shader* shader, float deltaTime)
+
+void TerrainChunk::cull(const Frustum& frustum)
 {
+    int count = unbakedBounds.size();
+    unbakedVisible.resize(count);
+    
+    Visibility visibility = meshFirst >= 0 ? frustum.test(box) : OUTSIDE;
+    if(visibility != INTERSECTING)
+    {
+        //all or nothing, the parts don't need testing
+        bool visible = visibility == INSIDE;
+        meshVisible = visible;
+        batchVisible = visible;
+        std::fill(unbakedVisible.begin(), unbakedVisible.end(), visible);
+        return;
+    }
+    
+    meshVisible = frustum.test(meshBox) != OUTSIDE;
+    batchVisible = frustum.test(batchBox) != OUTSIDE;
+    frustum.test(unbakedBounds.data(), count, unbakedVisible.data());
+}
+
+void TerrainChunk::addOccluders(HorizonBuffer& horizon, int cellPoints)
+{
+    //only the ground that is drawn hides anything
+    if(meshFirst < 0)
+    {
+        return;
+    }
     
-    //shader->use();
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse(model));
+    int cells = (size - 2) / cellPoints + 1;
+    if(groundMinimum.empty() || groundCellPoints != cellPoints)
+    {
+        groundCellPoints = cellPoints;
+        groundMinimum.assign(cells * cells, 1e30f);
+        for(int x = 0; x < size; x++)
+        {
+            for(int y = 0; y < size; y++)
+            {
+                //points on a cell border belong to both cells
+                for(int cellX = std::max(0, (x - 1) / cellPoints); cellX <= std::min(cells - 1, x / cellPoints); cellX++)
+                {
+                    for(int cellY = std::max(0, (y - 1) / cellPoints); cellY <= std::min(cells - 1, y / cellPoints); cellY++)
+                    {
+                        float& lowest = groundMinimum[cellX * cells + cellY];
+                        lowest = std::min(lowest, heightMap[x][y]);
+                    }
+                }
+            }
+        }
+    }
     
-    // Broadcast the uniform values to the shaders
-    GLuint modelLoc = glGetUniformLocation(shader->program, "model");
-    GLint normalMatrixLoc = glGetUniformLocation(shader->program, "normalMatrix");
-    GLint matAmbientLoc = glGetUniformLocation(shader->program, "material.ambient");
-    GLint matDiffuseLoc = glGetUniformLocation(shader->program, "material.diffuse");
-    GLint matSpecularLoc = glGetUniformLocation(shader->program, "material.specular");
-    GLint matShineLoc = glGetUniformLocation(shader->program, "material.shininess");
+    //the triangles never dip below their corners, the ground is solid under a cell's lowest point
+    glm::vec2 origin(posX * (size-1), posY * (size-1));
+    for(int cellX = 0; cellX < cells; cellX++)
+    {
+        for(int cellY = 0; cellY < cells; cellY++)
+        {
+            glm::vec2 min = origin + glm::vec2(cellX * cellPoints, cellY * cellPoints);
+            glm::vec2 max = origin + glm::vec2(std::min((cellX + 1) * cellPoints, size - 1), std::min((cellY + 1) * cellPoints, size - 1));
+            horizon.addOccluder(min, max, groundMinimum[cellX * cells + cellY]);
+        }
+    }
+}
+
+void TerrainChunk::occlude(const HorizonBuffer& horizon)
+{
+    if(!meshVisible && !batchVisible && std::find(unbakedVisible.begin(), unbakedVisible.end(), 1) == unbakedVisible.end())
+    {
+        return;
+    }
     
-    glUniform3f(matAmbientLoc, material.ambient.x, material.ambient.y, material.ambient.z);
-    glUniform3f(matDiffuseLoc, material.diffuse.x, material.diffuse.y, material.diffuse.z);
-    glUniform3f(matSpecularLoc, material.specular.x, material.specular.y, material.specular.z);
-    glUniform1f(matShineLoc, material.shininess);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
+    if(horizon.isOccluded(box))
+    {
+        meshVisible = false;
+        batchVisible = false;
+        std::fill(unbakedVisible.begin(), unbakedVisible.end(), 0);
+        return;
+    }
     
+    meshVisible = meshVisible && !horizon.isOccluded(meshBox);
+    batchVisible = batchVisible && !horizon.isOccluded(batchBox);
+    for(int i = 0; i < unbakedVisible.size(); i++)
+    {
+        unbakedVisible[i] = unbakedVisible[i] && !horizon.isOccluded(unbakedBounds[i]);
+    }
+}
+
+void TerrainChunk::submit(RenderQueue& queue, Shader* shader, ChunkMeshBuffer& meshes)
+{
+    //draws of the chunk are sorted from its middle, the heightmap is already in world space
+    glm::vec3 center((posX + 0.5f) * (size-1), 0.0f, (posY + 0.5f) * (size-1));
     
-    // Draw object
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, finalVertices.size()/2);
-    glBindVertexArray(0);
+    //the ground is drawn with the other chunks' by Terrain::submit
+    if(meshVisible)
+    {
+        meshes.add(meshFirst);
+    }
     
-    //render all the entities contained in the chunk
-    for(auto entity : entities)
+    //the baked entities, animated by the shader
+    if(batchVisible)
     {
-        entity->animate(deltaTime);
-        entity->render(shader);
+        batch.submit(queue, shader, center);
     }
     
+    //the remaining entities one by one
+    for(int i = 0; i < unbakedVisible.size(); i++)
+    {
+        if(unbakedVisible[i])
+        {
+            unbakedEntities[i]->submit(queue, shader);
+        }
+    }
 }
 
-Terrain::Terrain()
+Terrain::Terrain(WorkerPool& workers) : workers(workers)
 {
     //load terrain config
     Config config("res/config/Terrain.config");
     
     size = config.getConfig()->getInt("size");
     renderDistance = config.getConfig()->getInt("renderDistance");
+    prefetchDistance = config.getConfig()->getInt("prefetchDistance");
+    evictDistance = config.getConfig()->getInt("evictDistance");
+    horizonCellSize = config.getConfig()->getInt("horizonCellSize");
+    seed = std::stoull(config.getConfig()->getString("seed"));
+    placementRules = PlacementRules(config.getConfig()->getSection("placement"));
+    
+    ConfigSection* strandConfig = config.getConfig()->getSection("strands");
+    Seaweed::strands = strandConfig->getInt("enabled") != 0;
+    StrandBatch::buoyancy = strandConfig->getFloat("buoyancy");
+    StrandBatch::damping = strandConfig->getFloat("damping");
+    
+    ConfigSection* coralConfig = config.getConfig()->getSection("coral");
+    Coral::growthInterval = coralConfig->getFloat("growthInterval");
+    growthBudget = coralConfig->getInt("growthBudget");
     
     chunks = new TerrainChunk**[size];
     
@@ -229,6 +469,8 @@ Terrain::Terrain()
     
     int finalSize = size * (pointsPerChunk-1);
     
+    obstacles = new SpatialGrid(finalSize, config.getConfig()->getFloat("obstacleCellSize"));
+    
     //generate chunks and store in chunk array
     for(int x = 0; x < size; x++)
     {
@@ -236,9 +478,12 @@ Terrain::Terrain()
         
         for(int y = 0; y < size; y++)
         {
-            chunks[x][y] = new TerrainChunk(pointsPerChunk, x, y, (float)size/2.0f ,perlin, finalSize);
+            chunks[x][y] = new TerrainChunk(pointsPerChunk, x, y, (float)size/2.0f ,perlin, finalSize, seed);
         }
     }
+    
+    //the heightmap has to exist, it is where the flow's obstacles come from
+    current = new OceanCurrent(finalSize, config.getConfig()->getSection("current"), this, workers);
 }
 
 
@@ -327,13 +572,47 @@ void Terrain::updateChunks(glm::vec3 position)
                 
                 if(dx > renderDistance || dy > renderDistance)
                 {
-                    loadedChunk->unload();
+                    loadedChunk->unload(meshes);
                     loadedChunks.erase (loadedChunks.begin()+i);
                     i--;
                 }
             }
         }
         
+        //discard entities of chunks far away, they are placed again from the chunk seed when we come back
+        for(int i=0; i < populatedChunks.size(); i++)
+        {
+            TerrainChunk* populatedChunk = populatedChunks.at(i);
+            
+            int dx = abs(chunk->getPosX() - populatedChunk->getPosX());
+            int dy = abs(chunk->getPosY() - populatedChunk->getPosY());
+            
+            if(dx > evictDistance || dy > evictDistance)
+            {
+                removeObstacles(populatedChunk);
+                populatedChunk->depopulate();
+                populatedChunks.erase(populatedChunks.begin()+i);
+                i--;
+            }
+        }
+        
+        //populate chunks before they come into view
+        std::vector<TerrainChunk*> chunksToPopulate;
+        for(int x = std::max(0, chunk->getPosX()-prefetchDistance); x <= std::min(size-1, chunk->getPosX()+prefetchDistance); x++)
+        {
+            for(int y = std::max(0, chunk->getPosY()-prefetchDistance); y <= std::min(size-1, chunk->getPosY()+prefetchDistance); y++)
+            {
+                if(!getChunkAt(x,y)->isPopulated())
+                {
+                    chunksToPopulate.push_back(getChunkAt(x,y));
+                }
+            }
+        }
+        if(!chunksToPopulate.empty())
+        {
+            populate(chunksToPopulate);
+        }
+        
         //make sure draw distance is contained within terrain size
         int minX = chunk->getPosX()-renderDistance;
         int minY = chunk->getPosY()-renderDistance;
@@ -366,7 +645,7 @@ void Terrain::updateChunks(glm::vec3 position)
             for(int y = minY; y <= maxY; y++)
             {
                 TerrainChunk* chunkToLoad = getChunkAt(x,y);
-                if(chunkToLoad->load())
+                if(chunkToLoad->load(meshes))
                 {
                     loadedChunks.push_back(chunkToLoad);
                 }
@@ -376,20 +655,44 @@ void Terrain::updateChunks(glm::vec3 position)
     }
     else //if out of bounds, render everything, mainly for debug purposes
     {
+        std::vector<TerrainChunk*> chunksToPopulate;
+        for(int x = 0; x < size; x++)
+        {
+            for(int y = 0; y < size; y++)
+            {
+                if(!getChunkAt(x,y)->isPopulated())
+                {
+                    chunksToPopulate.push_back(getChunkAt(x,y));
+                }
+            }
+        }
+        if(!chunksToPopulate.empty())
+        {
+            populate(chunksToPopulate);
+        }
+        
         for(int x = 0; x < size; x++)
         {
             for(int y = 0; y < size; y++)
             {
-                getChunkAt(x,y)->load();
+                getChunkAt(x,y)->load(meshes);
             }
         }
     }
     
 }
 
-void Terrain::render(glm::vec3 position, Shader* shader, float deltaTime)
+void Terrain::submit(RenderQueue& queue, glm::vec3 position, Shader* shader, float deltaTime, Culler& culler)
 {
-    //render from position outwards in all directions
+    if(Seaweed::strands)
+    {
+        simulateStrands(deltaTime);
+    }
+    
+    growEntities(deltaTime);
+    
+    //chunks from position outwards in all directions
+    windowChunks.clear();
     TerrainChunk* chunk = getChunkAt(-position.x/(pointsPerChunk-1), -position.z/(pointsPerChunk-1));
     if(chunk != nullptr)
     {
@@ -424,22 +727,98 @@ void Terrain::render(glm::vec3 position, Shader* shader, float deltaTime)
         {
             for(int y = minY; y <= maxY; y++)
             {
-                getChunkAt(x,y)->render(shader, deltaTime);
+                windowChunks.push_back(getChunkAt(x,y));
             }
         }
         
     }
-    else //if out of bounds, render everything, mainly for debug purposes
+    else //if out of bounds, take everything, mainly for debug purposes
     {
         for(int x = 0; x < size; x++)
         {
             for(int y = 0; y < size; y++)
             {
-                getChunkAt(x,y)->render(shader, deltaTime);
+                windowChunks.push_back(getChunkAt(x,y));
             }
         }
     }
     
+    for(auto chunk : windowChunks)
+    {
+        chunk->prepare(deltaTime);
+    }
+    
+    const Frustum& frustum = culler.getFrustum();
+    culler.parallelFor(windowChunks.size(), [this, &frustum](int i)
+    {
+        windowChunks[i]->cull(frustum);
+    });
+    
+    //the ground hides what is behind it, only trusted while the eye is above it
+    glm::vec3 eye = -position;
+    if(horizonCellSize > 0 && eye.y > getHeightAt(eye.x, eye.z))
+    {
+        HorizonBuffer& horizon = culler.getHorizon();
+        horizon.begin(eye, horizonCellSize);
+        for(auto chunk : windowChunks)
+        {
+            chunk->addOccluders(horizon, horizonCellSize);
+        }
+        horizon.build();
+        
+        for(auto chunk : windowChunks)
+        {
+            chunk->occlude(horizon);
+        }
+    }
+    
+    meshes.begin();
+    for(auto chunk : windowChunks)
+    {
+        chunk->submit(queue, shader, meshes);
+    }
+    
+    //the ground of every visible chunk in one draw, the chunks share their material and have no model transform
+    if(!windowChunks.empty())
+    {
+        TerrainChunk* first = windowChunks.front();
+        meshes.submit(queue, shader, first->material.index, eye, Renderable::applyDraw, first);
+    }
+    
+    //instances of every loaded chunk, culled one by one on the gpu
+    if(IndirectBatch::isEnabled())
+    {
+        IndirectBatch::submitShared(queue, shader, eye);
+    }
+}
+
+void Terrain::simulateStrands(float deltaTime)
+{
+    std::vector<StrandBatch*> batches;
+    for(auto chunk : loadedChunks)
+    {
+        StrandBatch* strands = chunk->getStrands();
+        if(strands != nullptr)
+        {
+            batches.push_back(strands);
+        }
+    }
+    
+    StrandBatch::simulateAll(batches, deltaTime, current, workers);
+}
+
+void Terrain::growEntities(float deltaTime)
+{
+    Coral::clock += deltaTime;
+    
+    int budget = growthBudget;
+    int chunkCount = loadedChunks.size();
+    for(int i = 0; i < chunkCount && budget > 0; i++)
+    {
+        loadedChunks[(growthCursor + i) % chunkCount]->grow(budget);
+    }
+    
+    growthCursor = chunkCount > 0 ? (growthCursor + 1) % chunkCount : 0;
 }
 
 int Terrain::getRenderDistance()
@@ -447,28 +826,111 @@ int Terrain::getRenderDistance()
     return renderDistance;
 }
 
+uint64_t Terrain::getSeed()
+{
+    return seed;
+}
+
+void Terrain::populate(std::vector<TerrainChunk*> chunksToPopulate)
+{
+    //every chunk only depends on its own seed and heightmap
+    //so the result is the same no matter which worker takes which chunk
+    workers.parallelFor(chunksToPopulate.size(), [this, &chunksToPopulate](int index)
+    {
+        chunksToPopulate[index]->place(placementRules);
+    });
+    
+    for(auto chunk : chunksToPopulate)
+    {
+        chunk->spawnEntities();
+        addObstacles(chunk);
+        populatedChunks.push_back(chunk);
+    }
+}
+
+void Terrain::addObstacles(TerrainChunk* chunk)
+{
+    for(auto entity : chunk->getEntities())
+    {
+        if(entity->radius > 0)
+        {
+            SpatialEntry entry;
+            entry.center = glm::vec3(entity->model * glm::vec4(0, 0, 0, 1));
+            entry.radius = entity->radius;
+            entry.owner = entity;
+            obstacles->insert(entry);
+        }
+    }
+}
+
+void Terrain::removeObstacles(TerrainChunk* chunk)
+{
+    for(auto entity : chunk->getEntities())
+    {
+        if(entity->radius > 0)
+        {
+            obstacles->remove(entity, glm::vec3(entity->model * glm::vec4(0, 0, 0, 1)));
+        }
+    }
+}
+
 bool Terrain::isPositionValid(glm::vec3 position)
 {
     float height = getHeightAt(position.x, position.z) + 1.5f;
     if(height < position.y)
     {
-        TerrainChunk* chunk = getChunkAtReal(position.x, position.z);
-        if(chunk!=nullptr)
+        //entities of every chunk around the position, not only the one it is in
+        return !obstacles->containsPoint(position);
+    }
+    return false;
+}
+
+bool Terrain::sweep(glm::vec3 start, glm::vec3 end, float radius, float& t)
+{
+    //entities first, the terrain only needs to be marched up to where they are hit
+    bool hit = obstacles->sweepSphere(start, end, radius, t);
+    
+    //march the heightmap at half a grid step so no point is skipped
+    glm::vec3 path = end - start;
+    int steps = (int)std::ceil(glm::length(glm::vec2(path.x, path.z)) * t / 0.5f) + 1;
+    
+    float previous = 0.0f;
+    for(int i = 0; i <= steps; i++)
+    {
+        float s = t * i / steps;
+        glm::vec3 point = start + path * s;
+        if(point.y < getHeightAt(point.x, point.z) + radius)
         {
-            for(auto *entity : chunk->getEntities())
+            //refine between the last point above ground and this one
+            float above = previous;
+            float below = s;
+            for(int j = 0; j < 8 && i > 0; j++)
             {
-                if(entity->radius > 0)
+                float middle = (above + below) * 0.5f;
+                point = start + path * middle;
+                if(point.y < getHeightAt(point.x, point.z) + radius)
                 {
-                    glm::vec3 entityPosition = entity->model * glm::vec4(0, 0, 0, 1);
-                    float distance = glm::distance(entityPosition, position);
-                    if(distance < entity->radius)
-                    {
-                        return false;
-                    }
+                    below = middle;
+                }
+                else
+                {
+                    above = middle;
                 }
             }
+            t = i > 0 ? above : 0.0f;
+            return true;
         }
-        return true;
+        previous = s;
     }
-    return false;
+    return hit;
+}
+
+OceanCurrent* Terrain::getCurrent()
+{
+    return current;
+}
+
+SpatialGrid* Terrain::getObstacles()
+{
+    return obstacles;
 }
\ No newline at end of file
@@ -5,6 +5,17 @@
 #include "Config.h"
 #include "Seaweed.h"
 #include "Rock.h"
+#include "Coral.h"
+#include "ChunkBatch.h"
+#include "StrandBatch.h"
+#include "ChunkArena.h"
+#include "Random.h"
+#include "Placement.h"
+#include "SpatialGrid.h"
+#include "OceanCurrent.h"
+#include "Culling.h"
+#include "ChunkMeshBuffer.h"
+#include "WorkerPool.h"
 #include <GL\glew.h>
 #include <GLM\glm.hpp>
 #include <GLM\gtc\matrix_transform.hpp>
@@ -14,8 +25,8 @@
 class TerrainChunk : public Renderable
 {
     public:
-    //constructor specifies chunk size, position, offset in world, noise generator and the final terrain size
-    TerrainChunk(int size, int posX, int posY, float offset, SimplexNoise* pn, int finalSize);
+    //constructor specifies chunk size, position, offset in world, noise generator, the final terrain size and the world seed
+    TerrainChunk(int size, int posX, int posY, float offset, SimplexNoise* pn, int finalSize, uint64_t worldSeed);
     //get the size of the chunk
     int getSize();
     
@@ -26,8 +37,11 @@ class TerrainChunk : public Renderable
     int getPosX();
     int getPosY();
     
+    //seed of the chunk's random stream, derived from the world seed and chunk position
+    uint64_t getSeed();
+    
     //return a list of entities
-    std::vector<Renderable*>& getEntities()
+    ArenaVector<Renderable*>& getEntities()
     {
         return entities;
     }
@@ -36,43 +50,129 @@ class TerrainChunk : public Renderable
     float getHeightAt(int x, int y);
     void setHeightAt(int x, int y, float height);
     
-    //render chunk using specified shader
-    void render(Shader* shader, float deltaTime);
+    //rebake the entities if they changed and animate the ones drawn on their own, needs the gl context
+    void prepare(float deltaTime);
+    
+    //find what of the chunk is visible, the box of the whole chunk first, then the parts inside it
+    //only writes the chunk's own results so chunks can be culled on any thread
+    void cull(const Frustum& frustum);
+    
+    //add the ground of the chunk to the horizon, one block per cell of cellPoints heightmap points
+    void addOccluders(HorizonBuffer& horizon, int cellPoints);
+    
+    //drop what cull found visible but the horizon hides, the chunk box first then its parts
+    void occlude(const HorizonBuffer& horizon);
+    
+    //queue the draws the last cull found visible using specified shader, the ground goes to the meshes' multi draw
+    void submit(RenderQueue& queue, Shader* shader, ChunkMeshBuffer& meshes);
+    
+    //simulated seaweed of the chunk, null if it has none or isn't loaded
+    StrandBatch* getStrands();
     
-    //add entity to chunk
+    //let the baked entities grow, budget is the number of growth steps left this frame
+    void grow(int& budget);
+    
+    //add entity to chunk, entities not created by spawnEntities stay owned by the caller
     void addEntity(Renderable* r);
-    //load chunk
-    bool load();
+    //remove entity from chunk
+    void removeEntity(Renderable* r);
+    
+    //compute where the chunk's entities go, only reads the chunk so it is safe on any thread
+    void place(const PlacementRules& rules);
+    //create the placed entities, needs the gl context
+    void spawnEntities();
+    //delete every entity, they can be placed again from the chunk seed and the corals come back as grown as they were
+    void depopulate();
+    //true once the entities have been placed and created
+    bool isPopulated();
+    //load chunk, its ground mesh goes to a slot of meshes
+    bool load(ChunkMeshBuffer& meshes);
     //unload chunk
-    void unload();
+    void unload(ChunkMeshBuffer& meshes);
     
     private:
     //width and height of chunk
     const int size;
     
+    //memory of the spawned entities and of the arrays below that live as long as them, freed all at once by depopulate
+    ChunkArena arena;
+    
     //list of entites contained in chunk
-    std::vector<Renderable*> entities;;
+    ArenaVector<Renderable*> entities;
     
     //chunk position
     const int posX, posY;
     
+    const uint64_t seed;
+    
     //heightmap grid
     float** heightMap;
     
-    //final chunk vertices
+    //final chunk vertices, only kept while uploading
     std::vector<glm::vec3> finalVertices;
     
+    //first vertex of the ground mesh in the shared buffer, -1 while the chunk isn't loaded
+    GLint meshFirst = -1;
+    
+    //entities placed but not created yet, filled on a worker thread, which is the only one using the arena then
+    ArenaVector<Placement> placements;
+    
+    //corals of the chunk in placement order, and how far they had grown when the chunk was last depopulated
+    //placement gives the same corals every time, so each one gets its own growth back when spawned again
+    //the growth outlives the arena
+    ArenaVector<Coral*> corals;
+    std::vector<CoralGrowth> coralGrowth;
+    
+    bool populated = false;
+    
+    //static entities merged into a few draw calls
+    ChunkBatch batch;
+    
+    //entities that could not be baked, rendered one by one
+    std::vector<Renderable*> unbakedEntities;
+    
+    //set when entities are added or removed, batch gets rebuilt before next render
+    bool batchDirty = true;
+    
+    //world space boxes of the heightmap, of the baked entities and of everything in the chunk
+    BoundingBox meshBox;
+    BoundingBox batchBox;
+    BoundingBox box;
+    
+    //spheres of the unbaked entities, updated after they animate
+    std::vector<Bounds> unbakedBounds;
+    
+    //lowest height of each cell of groundCellPoints heightmap points, rebuilt when the heights change
+    std::vector<float> groundMinimum;
+    int groundCellPoints = 0;
+    
+    //result of the last cull, one flag per unbaked entity
+    bool meshVisible = false;
+    bool batchVisible = false;
+    std::vector<uint8_t> unbakedVisible;
+    
+    //rebuild the batch from the entity list
+    void bakeEntities();
     
+    //world position of a heightmap point
+    glm::vec3 getPoint(int x, int y);
+    
+    //fill finalVertices with the triangles of the heightmap
+    void buildMesh();
 };
 
 //conttains all terrain info
 class Terrain
 {
     public:
-    Terrain();
+    //workers are shared with the rest of the frame, the flow and the strands are stepped on them
+    Terrain(WorkerPool& workers);
     
-    //render terrain using a position and shader
-    void render(glm::vec3 position, Shader* shader, float deltaTime);
+    //queue the draws of the visible chunks around a position using specified shader
+    //chunks are culled in parallel by the culler, their entities only if the chunk is partly visible
+    //then the ground of the chunks builds the culler's horizon, which hides the chunks and parts behind ridges
+    //the ground of every chunk left is one multi draw from the shared mesh buffer
+    void submit(RenderQueue& queue, glm::vec3 position, Shader* shader, float deltaTime, Culler& culler);
     
     //get terrain size in chunks
     int getSize();
@@ -91,15 +191,33 @@ class Terrain
     
     //update chunks that should be rendered
     //loads and unloads chuns depending on distance from position and view distance
+    //populates chunks within the prefetch distance and discards entities past the evict distance
     void updateChunks(glm::vec3 position);
     
     //get view distance / render distance
     int getRenderDistance();
     
+    //get world seed
+    uint64_t getSeed();
+    
+    //place and create the entities of chunks that have none yet
+    //placement runs one chunk per job on the workers, entities are created on the calling thread
+    void populate(std::vector<TerrainChunk*> chunksToPopulate);
+    
     //returns if position is valid
     //ie if it collides with terrain or not
     bool isPositionValid(glm::vec3 position);
     
+    //move a sphere from start to end, returns true if it touches the terrain or an entity on the way
+    //t is set to the fraction of the path travelled before the first contact
+    bool sweep(glm::vec3 start, glm::vec3 end, float radius, float& t);
+    
+    //bounding spheres of the entities of populated chunks, in world space
+    SpatialGrid* getObstacles();
+    
+    //flow of the ocean over the terrain
+    OceanCurrent* getCurrent();
+    
     private:
     
     //number of chunks on x,y
@@ -107,13 +225,58 @@ class Terrain
     
     int renderDistance;
     
+    //chunks closer than this get their entities, in chunks
+    int prefetchDistance;
+    
+    //chunks further than this lose their entities, in chunks
+    int evictDistance;
+    
     int pointsPerChunk;
     
+    uint64_t seed;
+    
+    //entity density rules
+    PlacementRules placementRules;
+    
     std::vector<TerrainChunk*> loadedChunks;
     
+    std::vector<TerrainChunk*> populatedChunks;
+    
+    WorkerPool& workers;
+    
+    //flow simulated over the whole terrain, ridges of the heightmap block it
+    OceanCurrent* current;
+    
+    //step the seaweed strands of the loaded chunks
+    void simulateStrands(float deltaTime);
+    
+    //growth steps allowed per frame over all chunks
+    int growthBudget;
+    //chunk that grows first next frame, moves every frame so every chunk gets its turn
+    int growthCursor = 0;
+    
+    //advance the coral clock and grow the entities of the loaded chunks within the budget
+    void growEntities(float deltaTime);
+    
+    //index of the entities of populated chunks, kept in sync by populate and eviction
+    SpatialGrid* obstacles;
+    
+    //add or remove a chunk's entities to the obstacle index
+    void addObstacles(TerrainChunk* chunk);
+    void removeObstacles(TerrainChunk* chunk);
+    
     //chunk grid
     TerrainChunk*** chunks;
     
+    //chunks in the render window this frame
+    std::vector<TerrainChunk*> windowChunks;
+    
+    //ground meshes of the loaded chunks, drawn together
+    ChunkMeshBuffer meshes;
+    
+    //heightmap points per side of the ground blocks of the horizon culling, 0 turns it off
+    int horizonCellSize;
+    
     
     
 };
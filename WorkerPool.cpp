@@ -0,0 +1,85 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(int threadCount) : next(0)
+{
+    if(threadCount <= 0)
+    {
+        threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    //the caller of parallelFor is the last worker
+    for(int i = 0; i < threadCount - 1; i++)
+    {
+        threads.push_back(std::thread(&WorkerPool::work, this));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::parallelFor(int count, const std::function<void(int)>& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job = &job;
+        this->count = count;
+        next = 0;
+        active = threads.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    run();
+
+    //every worker has to be done before the job goes out of scope
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return active == 0; });
+    this->job = nullptr;
+}
+
+void WorkerPool::work()
+{
+    uint64_t seen = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+            if(stopping)
+            {
+                return;
+            }
+            seen = generation;
+        }
+
+        run();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--active == 0)
+        {
+            done.notify_one();
+        }
+    }
+}
+
+void WorkerPool::run()
+{
+    int index;
+    while((index = next++) < count)
+    {
+        (*job)(index);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//threads kept alive between jobs, for work split in many short passes every frame
+//where starting new threads each time would cost more than the work itself
+class WorkerPool
+{
+    public:
+
+    //threadCount 0 uses one thread per core, the calling thread counts as one of them
+    WorkerPool(int threadCount = 0);
+    ~WorkerPool();
+
+    //run job(i) for every i in [0, count) and wait for all of them
+    //the calling thread takes part, jobs can run in any order
+    //one pool is shared by the systems of the frame, so it is only called from the main loop and never from a job
+    void parallelFor(int count, const std::function<void(int)>& job);
+
+    private:
+
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    //current job, only valid during parallelFor
+    const std::function<void(int)>* job = nullptr;
+    int count = 0;
+    std::atomic<int> next;
+
+    //workers still running the current job
+    int active = 0;
+    //changes every parallelFor so sleeping workers know there is a new job
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    void work();
+    void run();
+};
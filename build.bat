@@ -5,12 +5,16 @@ pushd build
 
 set CompilerFlags=-FC -Zi /W0
 
-set Files=..\main.cpp ..\Cube.cpp ..\Seaweed.cpp  ..\Fish.cpp ..\Renderable.cpp ..\Terrain.cpp ..\TerrainGenerator.cpp  ..\Skybox.cpp ..\Config.cpp ..\Rock.cpp ..\Material.cpp ..\DirectionalLight.cpp  ..\PointLight.cpp ..\Spotlight.cpp ..\Light.cpp ..\GlowFish.cpp ..\Coral.cpp ..\Harpoon.cpp
+set Files=..\main.cpp ..\Cube.cpp ..\Seaweed.cpp  ..\Fish.cpp ..\FishSchool.cpp ..\FishPopulation.cpp ..\Renderable.cpp ..\Terrain.cpp ..\SpatialGrid.cpp ..\ChunkBatch.cpp ..\ChunkMeshBuffer.cpp ..\StrandBatch.cpp ..\OceanCurrent.cpp ..\WorkerPool.cpp ..\ParticleSystem.cpp ..\FrameUniforms.cpp ..\ChunkArena.cpp ..\Placement.cpp ..\MeshArchive.cpp ..\TerrainGenerator.cpp  ..\Skybox.cpp ..\Config.cpp ..\Rock.cpp ..\Material.cpp ..\MaterialPalette.cpp ..\RenderQueue.cpp ..\LightClusters.cpp ..\Culling.cpp ..\Horizon.cpp ..\IndirectBatch.cpp ..\DirectionalLight.cpp  ..\PointLight.cpp ..\Spotlight.cpp ..\Light.cpp ..\GlowFish.cpp ..\Coral.cpp ..\Harpoon.cpp
 
 set Libs=user32.lib gdi32.lib opengl32.lib ..\LIBS\glfw3.lib msvcrtd.lib msvcmrtd.lib LIBCMT.lib Shell32.lib ..\LIBS\glew32s.lib ..\LIBS\SOIL.lib 
 
 
 cl %Files% %CompilerFlags% %libs% /EHsc /I..\INCLUDE /W0
 
+REM Offline mesh converter, rebuild res\meshes\meshes.pak with
+REM MeshPacker ..\res\meshes\meshes.pak ..\res\meshes\src\seaweed_green.obj ..\res\meshes\src\seaweed_red.obj ..\res\meshes\src\fish.obj
+cl ..\tools\MeshPacker.cpp /EHsc /W0 /Fe:MeshPacker.exe
+
 
 popd
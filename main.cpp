@@ -4,8 +4,6 @@
 #include <GL\glew.h>
 #include <GLFW\glfw3.h>
 #include <GLM\gtc\type_ptr.hpp>
-#include <random>
-#include <time.h>
 #include <string>
 #include <thread>
 
@@ -14,6 +12,8 @@
 #include "Cube.h"
 #include "Rock.h"
 #include "Fish.h"
+#include "FishSchool.h"
+#include "FishPopulation.h"
 #include "Skybox.h"
 #include "Terrain.h"
 #include "Seaweed.h"
@@ -23,10 +23,30 @@
 #include "GlowFish.h"
 #include "Coral.h"
 #include "Harpoon.h"
+#include "ParticleSystem.h"
+#include "FrameUniforms.h"
+#include "LightClusters.h"
+#include "Config.h"
+#include "MaterialPalette.h"
+#include "RenderQueue.h"
+#include "Culling.h"
+#include "IndirectBatch.h"
+#include "MeshArchive.h"
+#include "Random.h"
+#include "WorkerPool.h"
 
 
 #define PI 3.14159265358979323846
 
+// World level random streams, derived from the world seed
+// chunks use their coordinates (always >= 0) so negative ids never collide with them
+enum RandomStream
+{
+    STREAM_FISH = -1,
+    STREAM_GLOWFISH = -2,
+    STREAM_PARTICLES = -3
+};
+
 // Global variables
 const int WIDTH = 1600, HEIGHT = 900;
 int SCREEN_WIDTH, SCREEN_HEIGHT;
@@ -42,9 +62,11 @@ bool keys[1024];
 
 Camera * camera = new Camera();
 
-std::vector<Fish*> fishes;
+FishSchool fishSchool;
+FishPopulation* fishPopulation;
 std::vector<GlowFish*> glowFish;
-std::vector<Harpoon*> harpoons;
+ParticleSystem* particles;
+HarpoonPool* harpoons;
 std::vector<Cube*> cubes;
 Skybox* skybox;
 DirectionalLight sun;
@@ -53,6 +75,20 @@ Terrain* terrain;
 Shader* lightingShader;
 Shader* lightSourceShader;
 Shader* skyboxShader;
+Shader* particleShader;
+// Compute pass of the gpu culling, null while it is off
+Shader* cullShader = nullptr;
+
+// Camera and light data for every shader, one buffer upload per frame
+FrameUniforms* frameUniforms;
+// Glowfish lights binned per view cluster, each fragment only shades the ones near it
+LightClusters* lightClusters;
+// Every draw of the frame, sorted by state before being issued
+RenderQueue renderQueue;
+// Drops what is off screen or lost in the fog before it reaches the queue
+Culler* culler;
+// Threads shared by every system that splits its frame work, one per core
+WorkerPool* workers;
 
 
 
@@ -63,20 +99,16 @@ void scrollCallback(GLFWwindow* window, double xOffset, double yOffset);
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void windowResizeCallback(GLFWwindow* window, int width, int height);
 void doMovement();
-void animateFish(float deltaTime);
-void animateFishThread(int start, int count);
-void animateHarpoon(float deltaTime);
 void createTerrainThread();
 
 
 // ________________________________ MAIN ________________________________
 int main()
 {
-    srand(time(NULL));
-    
-    
     // ___________________________ SETTINGS ___________________________
     
+    workers = new WorkerPool();
+    
     // Generate terrain
     std::thread terrainThread(createTerrainThread);
     
@@ -127,13 +159,16 @@ int main()
     glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
     
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
+    // Blending is only turned on for the blended pass of the render queue
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     glPointSize(3);
     
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     
+    // Materials past what the texture buffer holds get the fallback entry
+    MaterialPalette::init();
+    
     
     
     // ___________________________ END SETTINGS ___________________________
@@ -144,10 +179,40 @@ int main()
     
     // ____________________________ CREATING SCENE ____________________________
     
+	// Map packed meshes
+	if (!MeshArchive::open("res/meshes/meshes.pak"))
+	{
+		glfwTerminate();
+		exit(1);
+	}
+
 	// Create Shaders
 	lightingShader = new Shader("res/shaders/mainlit.vs", "res/shaders/mainlit.fs");
 	lightSourceShader = new Shader("res/shaders/lightsource.vs", "res/shaders/lightsource.fs");
 	skyboxShader = new Shader("res/shaders/skybox.vs", "res/shaders/skybox.fs");
+	particleShader = new Shader("res/shaders/particle.vs", "res/shaders/particle.fs");
+
+	// Frame and light blocks shared by the shaders
+	frameUniforms = new FrameUniforms();
+	frameUniforms->attach(lightingShader);
+	frameUniforms->attach(lightSourceShader);
+	frameUniforms->attach(particleShader);
+
+	// Instances culled by a compute pass instead of the culler, before any chunk bakes its instances
+	Config cullingConfig("res/config/Culling.config");
+	if (cullingConfig.getConfig()->getInt("gpu") != 0)
+	{
+		if (IndirectBatch::isSupported())
+		{
+			cullShader = new Shader("res/shaders/cull.cs");
+			frameUniforms->attach(cullShader);
+			IndirectBatch::enable(cullShader);
+		}
+		else
+		{
+			std::cout << "GPU culling needs OpenGL 4.3, culling on the CPU" << std::endl;
+		}
+	}
 
     // Generate skybox
     /*Timer::start("skybox");*/
@@ -161,81 +226,59 @@ int main()
     
     float terrainSize = (terrain->getSize()) * (terrain->getPointsPerChunk()-1);    
     
-    //Randomize fish locations
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> u1(0, 1);
-    
-    // Generate fish
-    Timer::start("fish");
-    for (int i = 0; i < 600; ++i)
-    {
-        fishes.push_back(new Fish(glm::vec3(u1(gen) * terrainSize, u1(gen) * 80.0f + 15.0f, u1(gen) * terrainSize)));
-    }
-    Timer::stop("Fish");
+    uint64_t worldSeed = terrain->getSeed();
     
-    // Generate glowing fish
+    // Generate glowing fish, every one carries a point light
     Timer::start("GlowFish");
-    for (int i = 0; i < 25; ++i)
+    Config lightingConfig("res/config/Lighting.config");
+    int glowFishCount = lightingConfig.getConfig()->getInt("glowFishCount");
+    lightClusters = new LightClusters(lightingConfig.getConfig()->getSection("clusters"), lightingConfig.getConfig()->getFloat("cutoff"), *workers);
+    Random glowFishRandom(Random::derive(worldSeed, STREAM_GLOWFISH));
+    for (int i = 0; i < glowFishCount; ++i)
     {
-        glowFish.push_back(new GlowFish(glm::vec3(u1(gen) * terrainSize, u1(gen) * 100.0f + 10.0f, u1(gen) * terrainSize)));
+        glm::vec3 position;
+        position.x = glowFishRandom.uniform() * terrainSize;
+        position.y = glowFishRandom.uniform() * 100.0f + 10.0f;
+        position.z = glowFishRandom.uniform() * terrainSize;
+        glowFish.push_back(new GlowFish(position, glowFishRandom.next64()));
     }
     Timer::stop("GlowFish");
     
     
-    // Generate seaweed
-    Timer::start("seaweed");
-    for (int i = 0; i < (int)(0.0002f*(terrainSize*terrainSize)); i++) 
-    {
-        float x = u1(gen) * terrainSize;
-        float z = u1(gen) * terrainSize;
-        
-        int patchSize = rand() % 20;
-        
-        for (float j = 0; j < patchSize; j++)
-        {
-            
-            int sx = x + u1(gen) * 20;
-            int sz = z + u1(gen) * 20;
-            
-            float y = terrain->getHeightAt(sx, sz);
-            
-            TerrainChunk* chunk = terrain->getChunkAtReal((int)sx, (int)sz);
-            if (chunk != nullptr)
-                chunk->addEntity(new Seaweed(glm::vec3(sx, y + 1, sz)));
-            
-        }
-    }
-    Timer::stop("seaweed");
-    
-    // Generate coral
-    Timer::start("coral");
-    for (int i = 0; i < (int)(0.0009f*terrainSize*terrainSize); i++)
-    {
-        float x = u1(gen) * terrainSize;
-        
-        float z = u1(gen) * terrainSize;
-        
-        float y = terrain->getHeightAt(x, z);
-        
-        TerrainChunk* chunk = terrain->getChunkAtReal((int)x, (int)z);
-        if (chunk != nullptr)
-            chunk->addEntity(new Coral(glm::vec3(-x, -y, -z)));
-    }
-    Timer::stop("Coral");
-    
     // ____________________________ END CREATING SCENE ____________________________
     
     
     camera->setPosition(glm::vec3(-float(terrainSize / 2), -40.0f, -float(terrainSize / 2)));
     
     camera->setPosition(glm::vec3(-float(terrainSize / 2), -(terrain->getHeightAt(terrainSize / 2,terrainSize/2)+5), -float(terrainSize / 2)));
+    
+    // Rocks, coral and seaweed are only created for the chunks around the camera
+    Timer::start("nearby chunks");
     terrain->updateChunks(camera->getPosition());
+    Timer::stop("Nearby chunks");
+    
+    // Only the fish around the camera are simulated, the rest of the ocean keeps a count per region
+    Timer::start("fish");
+    fishPopulation = new FishPopulation(&fishSchool, terrainSize, Random::derive(worldSeed, STREAM_FISH));
+    fishPopulation->update(-camera->getPosition());
+    Timer::stop("Fish");
+    
+    // Marine snow around the camera, bubbles and silt from the harpoons
+    Timer::start("particles");
+    particles = new ParticleSystem(Random::derive(worldSeed, STREAM_PARTICLES), *workers);
+    harpoons = new HarpoonPool(&fishSchool, particles);
+    Timer::stop("Particles");
     
 	// Create spotlight at camnera position
     spotLight = SpotLight(glm::vec3(0.5f, 0.5f, 0.2f), glm::vec3(0.3f, 0.3f, 0.05f), glm::vec3(1.0f, 1.0f, 1.0f),
                           camera->getPosition(), camera->getFront(), glm::cos(glm::radians(15.5f)), glm::cos(glm::radians(25.0f)), 1.0f, 0.0014f, 0.000007f);
     
+    culler = new Culler(*workers);
+    
+    // Spheres of the glowfish and which ones are on screen, refilled every frame
+    std::vector<Bounds> glowFishBounds;
+    std::vector<uint8_t> glowFishVisible;
+    
     // ___________________________ GAME LOOP ___________________________
     glfwShowWindow(window);
     while (!glfwWindowShouldClose(window)) {
@@ -269,82 +312,76 @@ int main()
         //glUniformMatrix4fv(glGetUniformLocation(skyboxShader->program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
         //skybox->render(skyboxShader);
         
-        //Terrain/fish/rocks/coral
-        lightingShader->use();
-
-        glUniform1f(glGetUniformLocation(lightingShader->program, "viewDistance"), viewDistance);
-        glUniformMatrix4fv(glGetUniformLocation(lightingShader->program, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(lightingShader->program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        glm::vec3 viewPos = -camera->getPosition();
         
-        // Set lighting uniforms
-        // Directional light
-        glUniform3f(glGetUniformLocation(lightingShader->program, "dirLight.direction"), sun.direction.x, sun.direction.y, sun.direction.z);
-        glUniform3f(glGetUniformLocation(lightingShader->program, "dirLight.ambient"), sun.ambient.x, sun.ambient.y, sun.ambient.z);
-        glUniform3f(glGetUniformLocation(lightingShader->program, "dirLight.diffuse"), sun.diffuse.x, sun.diffuse.y, sun.diffuse.z);
-        glUniform3f(glGetUniformLocation(lightingShader->program, "dirLight.specular"), sun.specular.x, sun.specular.y, sun.specular.z);
+        // Move the glowfish, they carry the point lights
+        for (auto gf : glowFish)
+        {
+            gf->animate(deltaTime, terrain);
+        }
         
-        // SpotLight
-        glUniform3f(glGetUniformLocation(lightingShader->program, "spotLight.position"), -camera->getPosition().x, -camera->getPosition().y, -camera->getPosition().z);
-        glUniform3f(glGetUniformLocation(lightingShader->program, "spotLight.direction"), -camera->getFront().x, -camera->getFront().y, -camera->getFront().z);
-        glUniform3f(glGetUniformLocation(lightingShader->program, "spotLight.ambient"), spotLight.ambient.x, spotLight.ambient.y, spotLight.ambient.z);
-        glUniform3f(glGetUniformLocation(lightingShader->program, "spotLight.diffuse"), spotLight.diffuse.x, spotLight.diffuse.y, spotLight.diffuse.z);
-        glUniform3f(glGetUniformLocation(lightingShader->program, "spotLight.specular"), spotLight.specular.x, spotLight.specular.y, spotLight.specular.z);
-        glUniform1f(glGetUniformLocation(lightingShader->program, "spotLight.constant"), spotLight.constant);
-        glUniform1f(glGetUniformLocation(lightingShader->program, "spotLight.linear"), spotLight.linear);
-        glUniform1f(glGetUniformLocation(lightingShader->program, "spotLight.quadratic"), spotLight.quadratic);
-        glUniform1f(glGetUniformLocation(lightingShader->program, "spotLight.cutOff"), spotLight.cutOff);
-        glUniform1f(glGetUniformLocation(lightingShader->program, "spotLight.outerCutOff"), spotLight.outerCutOff);
+        // Sort the glowfish lights into the clusters of this view
+        lightClusters->update(glowFish, view, projection, viewDistance);
         
-        glUniform3f(glGetUniformLocation(lightingShader->program, "viewPos"), -camera->getPosition().x, -camera->getPosition().y, -camera->getPosition().z);
+        // Spotlight follows the camera
+        spotLight.position = viewPos;
+        spotLight.direction = -camera->getFront();
         
-        // Point lights (glowfish)
-        for (int i = 0; i < glowFish.size(); i++)
-        {
-            glowFish.at(i)->animate(deltaTime, terrain);
-            std::string identifier = "pointLights[" + std::to_string(i) + "]";
-            
-            glUniform3f(glGetUniformLocation(lightingShader->program, (identifier + ".position").c_str()), glowFish.at(i)->getPosition().x, glowFish.at(i)->getPosition().y, glowFish.at(i)->getPosition().z);
-            glUniform3f(glGetUniformLocation(lightingShader->program, (identifier + ".ambient").c_str()), glowFish.at(i)->ambient.x, glowFish.at(i)->ambient.y, glowFish.at(i)->ambient.z);
-            glUniform3f(glGetUniformLocation(lightingShader->program, (identifier + ".diffuse").c_str()), glowFish.at(0)->diffuse.x, glowFish.at(0)->diffuse.y, glowFish.at(0)->diffuse.z);
-            glUniform3f(glGetUniformLocation(lightingShader->program, (identifier + ".specular").c_str()), glowFish.at(0)->specular.x, glowFish.at(0)->specular.y, glowFish.at(0)->specular.z);
-            glUniform1f(glGetUniformLocation(lightingShader->program, (identifier + ".constant").c_str()), glowFish.at(0)->constant);
-            glUniform1f(glGetUniformLocation(lightingShader->program, (identifier + ".linear").c_str()), glowFish.at(0)->linear);
-            glUniform1f(glGetUniformLocation(lightingShader->program, (identifier + ".quadratic").c_str()), glowFish.at(0)->quadratic);
-        }
+        // Camera and lights for every shader
+        frameUniforms->setCamera(view, projection, viewPos, viewDistance, currentFrame);
+        frameUniforms->setLights(sun, spotLight);
         
-        // Render the terrain and scene objects
-        terrain->render(camera->getPosition(), lightingShader, deltaTime);
+        // Step the ocean current, everything below drifts with it
+        terrain->getCurrent()->simulate(deltaTime);
         
-        animateFish(deltaTime);
-        // Render objects in the scene
-        for (auto fish : fishes)
-        {
-            fish->render(lightingShader);
-        }
+        // Collect every draw of the frame, nothing is drawn until the queue executes
+        renderQueue.begin(viewPos, viewDistance);
+        culler->begin(view, projection, viewPos, viewDistance);
         
-        animateHarpoon(deltaTime);
-        for (auto harpoon : harpoons)
-        {
-			if (!harpoon->isOutside)
-			{
-				harpoon->render(lightingShader);
-			}
-        }
-
+        // Terrain/rocks/coral/seaweed
+        terrain->submit(renderQueue, camera->getPosition(), lightingShader, deltaTime, *culler);
+        
+        // Stream fish in and out around the camera, then swim and draw them all at once
+        fishPopulation->update(-camera->getPosition());
+        fishSchool.animate(deltaTime, terrain, *workers);
+        fishSchool.submit(renderQueue, lightingShader, *culler);
         
-        // Render Glowfish as white
-        lightSourceShader->use();
-        glUniformMatrix4fv(glGetUniformLocation(lightSourceShader->program, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(lightSourceShader->program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniform1f(glGetUniformLocation(lightSourceShader->program, "viewDistance"),  viewDistance);
-        glUniform3f(glGetUniformLocation(lightingShader->program, "viewPos"), -camera->getPosition().x, -camera->getPosition().y, -camera->getPosition().z);
+        // Move and draw all the harpoons at once
+        harpoons->animate(deltaTime, terrain);
+        harpoons->submit(renderQueue, lightingShader, *culler);
         
-        //Render glowfish
+        // Glowfish are drawn as white, lightsource.fs has no fog so only the view limits them
+        glowFishBounds.clear();
         for (auto gf : glowFish)
         {
-            gf->render(lightSourceShader);
+            glowFishBounds.push_back(gf->getBounds());
+        }
+        culler->test(glowFishBounds, glowFishVisible, false);
+        for (int i = 0; i < glowFish.size(); i++)
+        {
+            if (glowFishVisible[i])
+            {
+                glowFish[i]->submit(renderQueue, lightSourceShader);
+            }
         }
         
+        // Drift the particles with the current, they are see-through and go to the blended pass
+        particles->simulate(deltaTime, terrain->getCurrent(), viewPos);
+        particles->submit(renderQueue, particleShader, viewPos);
+        
+        // Hand the ocean current to the shader for the sway
+        lightingShader->use();
+        terrain->getCurrent()->bind(lightingShader);
+        
+        // Materials of everything drawn with the lighting shader, including the ones added this frame
+        MaterialPalette::bind(lightingShader);
+        
+        // Point lights and their clusters
+        lightClusters->bind(lightingShader, SCREEN_WIDTH, SCREEN_HEIGHT);
+        
+        // Sort and draw everything
+        renderQueue.execute();
+        
         glfwSwapBuffers(window);
     }
     
@@ -353,6 +390,7 @@ int main()
     
     
     
+    MeshArchive::close();
     glfwDestroyWindow(window);
     //TODO: object buffer cleanup
     //glDeleteVertexArrays(1, &VAO);
@@ -431,7 +469,7 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
     {
         glm::vec3 harpoonPos;
         harpoonPos = camera->getPosition() + camera->getUp() - 0.7f *camera->getRight();
-        harpoons.push_back(new Harpoon(harpoonPos, camera->getFront()));
+        harpoons->fire(harpoonPos, camera->getFront());
     }
 }
 
@@ -546,74 +584,11 @@ void doMovement()
     
 }
 
-void animateFish(float deltaTime)
-{
-    int size = fishes.size();
-    
-    std::thread t0(animateFishThread, 0, size / 8);
-    std::thread t1(animateFishThread, size / 8, size / 8);
-    std::thread t2(animateFishThread, size / 4, size / 8);
-    std::thread t3(animateFishThread, 3 * size / 8, size / 8);
-    std::thread t4(animateFishThread, size / 2, size / 8);
-    std::thread t5(animateFishThread, 5 * size / 8, size / 8);
-    std::thread t6(animateFishThread, 3 * size / 4, size / 8);
-    std::thread t7(animateFishThread, 7 * size / 8, size / 8);
-    t0.join();
-    t1.join();
-    t2.join();
-    t3.join();
-    t4.join();
-    t5.join();
-    t6.join();
-    t7.join();
-}
-
-void animateFishThread(int start, int count)
-{
-    for (int i = start; i < start + count; ++i)
-    {
-        fishes[i]->animate(deltaTime, terrain);
-    }
-}
-
-void animateHarpoon(float deltaTime)
-{
-    for (auto harpoon : harpoons)
-    {
-        harpoon->animate(deltaTime, terrain);
-    }
-}
-
 void createTerrainThread()
 {
     Timer::start("terrain");
-    terrain = new Terrain();
+    terrain = new Terrain(*workers);
     Timer::stop("Terrain");
-    
-    float terrainSize = (terrain->getSize()) * (terrain->getPointsPerChunk()-1);
-    
-    
-    //Randomize fish locations
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> u1(0, 1);
-    
-    
-    
-    Timer::start("rock");
-    for(int i = 0; i < (int)(0.01f*terrainSize*terrainSize); i++)
-    {
-        float x = u1(gen) * terrainSize;
-        
-        float z = u1(gen) * terrainSize;
-        
-        float y = terrain->getHeightAt(x,z);
-        
-        TerrainChunk* chunk = terrain->getChunkAtReal((int)x,(int)z);
-        if(chunk != nullptr)
-            chunk->addEntity(new Rock(glm::vec3(-x, -y, -z)));
-    }
-    Timer::stop("rock");
     // ____________________________ END CREATING SCENE ____________________________
     
 }
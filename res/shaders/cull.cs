@@ -0,0 +1,81 @@
+#version 430 core
+
+// One invocation per instance slot of an IndirectBatch
+layout(local_size_x = 64) in;
+
+// Shared by every shader, filled once per frame, see FrameUniforms
+layout(std140) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	float viewDistance;
+	float time;
+};
+
+// Bounding sphere of every slot, center in xyz and radius in w
+layout(std430, binding = 0) readonly buffer Spheres {
+	vec4 spheres[];
+};
+
+// Draw command of every slot, 0xffffffff for slots nothing is drawn from
+layout(std430, binding = 1) readonly buffer Ranges {
+	uint rangeOf[];
+};
+
+// BatchInstance of every slot, copied word by word
+layout(std430, binding = 2) readonly buffer Source {
+	uint source[];
+};
+
+// Instances that pass, packed from the base instance of their command
+layout(std430, binding = 3) writeonly buffer Visible {
+	uint visible[];
+};
+
+// count, instanceCount, first, baseInstance of every command, instanceCount starts at 0
+layout(std430, binding = 4) buffer Commands {
+	uint commands[];
+};
+
+uniform int slotCount;
+uniform int instanceWords;
+
+void main()
+{
+	uint slot = gl_GlobalInvocationID.x;
+	if (slot >= uint(slotCount))
+		return;
+
+	uint range = rangeOf[slot];
+	if (range == 0xffffffffu)
+		return;
+
+	vec4 sphere = spheres[slot];
+
+	// Planes of the view, same test as Frustum::test in Culling.cpp
+	mat4 viewProjection = projection * view;
+	vec4 rowX = vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	vec4 rowY = vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	vec4 rowZ = vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	vec4 rowW = vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	vec4 planes[6] = vec4[6](rowW + rowX, rowW - rowX, rowW + rowY, rowW - rowY, rowW + rowZ, rowW - rowZ);
+
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(planes[i].xyz, sphere.xyz) + planes[i].w < -sphere.w * length(planes[i].xyz))
+			return;
+	}
+
+	// Past the fog, measured flat like in mainlit.fs
+	vec2 offset = sphere.xz - viewPos.xz;
+	float reach = viewDistance + sphere.w;
+	if (dot(offset, offset) > reach * reach)
+		return;
+
+	uint target = commands[range * 4u + 3u] + atomicAdd(commands[range * 4u + 1u], 1u);
+	uint words = uint(instanceWords);
+	for (uint i = 0u; i < words; i++)
+	{
+		visible[target * words + i] = source[slot * words + i];
+	}
+}
@@ -3,7 +3,14 @@ out vec4 color;
 
 in float DistanceFromView;
 
-uniform float viewDistance;
+// Shared by every shader, filled once per frame, see FrameUniforms
+layout(std140) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	float viewDistance;
+	float time;
+};
 
 void main()
 {
@@ -3,10 +3,16 @@ layout(location = 0) in vec3 position;
 
 out float DistanceFromView;
 
+// Shared by every shader, filled once per frame, see FrameUniforms
+layout(std140) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	float viewDistance;
+	float time;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 viewPos;
 
 void main()
 {
@@ -18,9 +18,10 @@ struct DirLight {
 
 
 
-// Point lights
+// Point lights, read from pointLightData, see LightClusters
 struct PointLight {    
     vec3 position;
+    float radius;
     
     float constant;
     float linear;
@@ -30,23 +31,20 @@ struct PointLight {
     vec3 diffuse;
     vec3 specular;
 };
-#define NR_POINT_LIGHTS 25  
 
 
 // Spot lights
 struct SpotLight {
     vec3 position;
-    vec3 direction;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
     vec3 ambient;
+    float constant;
     vec3 diffuse;
+    float linear;
     vec3 specular;       
+    float quadratic;
 };
 
 
@@ -55,26 +53,55 @@ in vec3 FragPos;
 in vec3 Normal;  
 in float Opacity;  
 in float DistanceFromView;
+in float ViewDepth;
+
+flat in vec3 MatAmbient;
+flat in vec3 MatDiffuse;
+flat in vec3 MatSpecular;
+flat in float MatShininess;
 
 out vec4 color;
  
 
-//Uniforms 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight;
-uniform Material material;
+// Shared by every shader, filled once per frame, see FrameUniforms
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    float viewDistance;
+    float time;
+};
+
+layout(std140) uniform Lights {
+    DirLight dirLight;
+    SpotLight spotLight;
+};
 
-uniform float viewDistance;
+// Clustered point lights, see LightClusters
+// Four texels per light: position and radius, ambient and constant, diffuse and linear, specular and quadratic
+uniform samplerBuffer pointLightData;
+// Per cluster, where its lights start in clusterLights and how many there are
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLights;
+// Tiles across, down and depth slices, tile size in pixels, slices are exponential from clusterNear
+uniform ivec3 clusterCount;
+uniform vec2 clusterTileSize;
+uniform float clusterNear;
+uniform float clusterSliceScale;
+
+// Set per object or per vertex by the vertex shader
+Material material;
 
 //Function prototypes
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);  
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+PointLight FetchPointLight(int index);
 
 void main()
 {
+    material = Material(MatAmbient, MatDiffuse, MatSpecular, MatShininess);
+
     // Properties
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
@@ -82,9 +109,13 @@ void main()
 	vec3 result=vec3(0.0, 0.0, 0.0);
     // Phase 1: Directional lighting
     result += CalcDirLight(dirLight, norm, viewDir);
-    // Phase 2: Point lights
-    for(int i = 0; i < NR_POINT_LIGHTS; i++)
-      result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);    
+    // Phase 2: Point lights of this fragment's cluster
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), clusterCount.xy - 1);
+    int slice = int(log(max(ViewDepth, clusterNear) / clusterNear) * clusterSliceScale);
+    slice = clamp(slice, 0, clusterCount.z - 1);
+    uvec2 range = texelFetch(clusterRanges, (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x).rg;
+    for(uint i = 0u; i < range.y; i++)
+      result += CalcPointLight(FetchPointLight(int(texelFetch(clusterLights, int(range.x + i)).r)), norm, FragPos, viewDir);    
     // Phase 3: Spot light
     result += CalcSpotLight(spotLight, norm, FragPos, viewDir);    
     
@@ -113,6 +144,17 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
 }
 
 
+// Reads a point light from the light buffer
+PointLight FetchPointLight(int index)
+{
+    vec4 positionRadius = texelFetch(pointLightData, index * 4);
+    vec4 ambientConstant = texelFetch(pointLightData, index * 4 + 1);
+    vec4 diffuseLinear = texelFetch(pointLightData, index * 4 + 2);
+    vec4 specularQuadratic = texelFetch(pointLightData, index * 4 + 3);
+    return PointLight(positionRadius.xyz, positionRadius.w, ambientConstant.w, diffuseLinear.w, specularQuadratic.w,
+                      ambientConstant.rgb, diffuseLinear.rgb, specularQuadratic.rgb);
+}
+
 // Calculates the color when using a point light.
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
@@ -126,6 +168,9 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance    = length(light.position - fragPos);
     float attenuation = 1.0f / (light.constant + light.linear * distance + 
   			     light.quadratic * (distance * distance));    
+    // Fade to nothing at the radius the light was binned with, no seam at cluster edges
+    float falloff = clamp(1.0f - pow(distance / light.radius, 4.0f), 0.0f, 1.0f);
+    attenuation *= falloff * falloff;
     
 	// Combine results
     vec3 ambient  = light.ambient  * material.ambient;
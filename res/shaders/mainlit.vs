@@ -2,24 +2,127 @@
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
 
+// Batched geometry, see ChunkBatch
+layout(location = 2) in uint batchMaterial;   // entry in the material palette
+layout(location = 5) in vec3 swayAxis;
+layout(location = 6) in vec3 swayParams;      // phase, first wave weight, second wave weight
+layout(location = 7) in mat4 instanceModel;   // locations 7 to 10
+layout(location = 11) in vec3 instanceScale;
+// Simulated strands, offset of each particle from its rest position, see StrandBatch
+layout(location = 12) in vec3 strandOffset1;
+layout(location = 13) in vec3 strandOffset2;
+layout(location = 14) in vec3 strandOffset3;
+
 out vec3 Normal;
 out vec3 FragPos;
 out float Opacity;
 out float DistanceFromView;
+out float ViewDepth;
+
+flat out vec3 MatAmbient;
+flat out vec3 MatDiffuse;
+flat out vec3 MatSpecular;
+flat out float MatShininess;
+
+// Shared by every shader, filled once per frame, see FrameUniforms
+layout(std140) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	float viewDistance;
+	float time;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat3 normalMatrix;
-uniform vec3 viewPos;
+uniform int materialIndex;
+
+// Every material, three texels per entry: ambient, diffuse, specular with shininess in a, see MaterialPalette
+uniform samplerBuffer materialPalette;
+
+// 0: single object, 1: baked chunk geometry, 2: instanced shared mesh, 3: instanced strand
+uniform int batchMode;
+// Shear used by instanced meshes, matches Seaweed::animate, 2 for none
+uniform int swayType;
+// Strand direction in mesh space and the extent of the mesh along it
+uniform vec3 strandAxis;
+uniform vec2 strandRange;
+// Ocean current over the world (rg = flow on x and z), see OceanCurrent
+uniform sampler2D currentField;
+uniform float currentInverseSize;
+uniform float currentStrength;
+
+// Sway harder where the local flow is faster than the overall current
+// never past the full sway, the bounding spheres the culling tests only make room for that much
+float currentSway(vec2 worldXZ)
+{
+	return min(length(texture(currentField, worldXZ * currentInverseSize).rg) / currentStrength, 1.0f);
+}
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(position, 1.0f);
-	FragPos = vec3(model * vec4(position, 1.f));
-	Normal = normalMatrix * normal;
-	vec4 realPos = model * vec4(position,1.0f);
+	vec4 realPos;
+
+	if (batchMode == 0)
+	{
+		realPos = model * vec4(position, 1.0f);
+		Normal = normalMatrix * normal;
+	}
+	else
+	{
+		float swayA = sin(time + swayParams.x);
+		float swayB = sin(time + swayParams.x + 1.584);
+
+		if (batchMode == 1)
+		{
+			// Already in world space, push along the sway axis
+			float sway = currentSway(position.xz);
+			realPos = vec4(position + swayAxis * sway * (swayA * swayParams.y + swayB * swayParams.z), 1.0f);
+			Normal = normal;
+		}
+		else if (batchMode == 3)
+		{
+			// Place the shared mesh, then move each vertex like the strand around its height
+			float along = 3.0f * clamp((dot(position, strandAxis) - strandRange.x) / (strandRange.y - strandRange.x), 0.0f, 1.0f);
+			vec3 offset;
+			if (along < 1.0f)
+				offset = strandOffset1 * along;
+			else if (along < 2.0f)
+				offset = mix(strandOffset1, strandOffset2, along - 1.0f);
+			else
+				offset = mix(strandOffset2, strandOffset3, along - 2.0f);
+
+			realPos = instanceModel * vec4(instanceScale * position, 1.0f) + vec4(offset, 0.0f);
+			Normal = mat3(instanceModel) * (normal / instanceScale);
+		}
+		else
+		{
+			// Scale, shear then place the shared mesh
+			vec3 local = instanceScale * position;
+			float sway = currentSway(instanceModel[3].xz);
+			swayA *= sway;
+			swayB *= sway;
+			if (swayType == 0)
+				local.y += swayA / 15.0f * local.x + swayB / 15.153f * local.z;
+			else if (swayType == 1)
+				local.z += swayA / 15.0f * local.y + swayB / 15.153f * local.x;
+
+			realPos = instanceModel * vec4(local, 1.0f);
+			Normal = mat3(instanceModel) * (normal / instanceScale);
+		}
+	}
+
+	int entry = 3 * (batchMode == 0 ? materialIndex : int(batchMaterial));
+	vec4 specular = texelFetch(materialPalette, entry + 2);
+	MatAmbient = texelFetch(materialPalette, entry).rgb;
+	MatDiffuse = texelFetch(materialPalette, entry + 1).rgb;
+	MatSpecular = specular.rgb;
+	MatShininess = specular.a;
+
+	gl_Position = projection * view * realPos;
+	FragPos = vec3(realPos);
 	DistanceFromView  = distance(vec2(realPos.x, realPos.z), vec2(viewPos.x, viewPos.z));
+	ViewDepth = -(view * realPos).z;
 	Opacity = 1.0f;
 
-}
\ No newline at end of file
+}
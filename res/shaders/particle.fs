@@ -0,0 +1,28 @@
+#version 330 core
+in vec2 Corner;
+in vec4 Color;
+in float DistanceFromView;
+
+out vec4 color;
+
+// Shared by every shader, filled once per frame, see FrameUniforms
+layout(std140) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	float viewDistance;
+	float time;
+};
+
+void main()
+{
+	// Round with a soft edge
+	float edge = 1.0f - dot(Corner, Corner);
+	if (edge <= 0.0f)
+		discard;
+
+	// Same fog as mainlit.fs
+	float ratio = min(1.0f,(1.0f-(max(0.0f, DistanceFromView-(viewDistance/2))/(viewDistance/2))));
+	vec3 fog = vec3((2.0f/255.0f), (34.0f/255.0f), (134.0f/255.0f));
+	color = vec4(mix(Color.rgb, fog, min(1.0f,(1-ratio))), Color.a * edge);
+}
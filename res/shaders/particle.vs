@@ -0,0 +1,33 @@
+#version 330 core
+layout(location = 0) in vec2 corner;
+
+// Per particle, see ParticleSystem
+layout(location = 1) in vec4 particle;        // position, size
+layout(location = 2) in vec4 particleColor;
+
+out vec2 Corner;
+out vec4 Color;
+out float DistanceFromView;
+
+// Shared by every shader, filled once per frame, see FrameUniforms
+layout(std140) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	float viewDistance;
+	float time;
+};
+
+void main()
+{
+	// Camera right and up are the first two rows of the view rotation
+	vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+	vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+
+	vec3 realPos = particle.xyz + (right * corner.x + up * corner.y) * particle.w;
+	gl_Position = projection * view * vec4(realPos, 1.0f);
+
+	Corner = corner;
+	Color = particleColor;
+	DistanceFromView = distance(vec2(realPos.x, realPos.z), vec2(viewPos.x, viewPos.z));
+}
@@ -0,0 +1,312 @@
+//Offline converter packing .obj meshes into the binary mesh archive read by MeshArchive
+//
+//usage: MeshPacker [--quantize] output.pak mesh1.obj [mesh2.obj ...]
+//
+//meshes are named after their file name without extension (res/meshes/src/fish.obj -> "fish")
+//faces are triangulated as fans, faces without normals get a flat face normal
+//--quantize stores positions as half floats and normals as 2_10_10_10, halving the size
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../MeshArchiveFormat.h"
+
+struct Vec3
+{
+    float x, y, z;
+};
+
+struct Vertex
+{
+    Vec3 position;
+    Vec3 normal;
+};
+
+//convert a float to an IEEE half float, rounding to nearest
+static uint16_t toHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    //zero, denormals and values too small for a half
+    if(exponent <= 0)
+    {
+        if(exponent < -10)
+        {
+            return uint16_t(sign);
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = uint32_t(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if((mantissa >> (shift - 1)) & 1)
+        {
+            half++;
+        }
+        return uint16_t(sign | half);
+    }
+
+    //too large, clamp to infinity
+    if(exponent >= 31)
+    {
+        return uint16_t(sign | 0x7C00);
+    }
+
+    uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+    if(mantissa & 0x1000)
+    {
+        half++;
+    }
+    return uint16_t(half);
+}
+
+//pack a unit normal as GL_INT_2_10_10_10_REV
+static uint32_t packNormal(Vec3 n)
+{
+    auto component = [](float v) -> uint32_t
+    {
+        if(v > 1.0f) v = 1.0f;
+        if(v < -1.0f) v = -1.0f;
+        int32_t i = int32_t(std::lround(v * 511.0f));
+        return uint32_t(i) & 0x3FF;
+    };
+    return component(n.x) | (component(n.y) << 10) | (component(n.z) << 20);
+}
+
+static Vec3 faceNormal(Vec3 a, Vec3 b, Vec3 c)
+{
+    Vec3 e1 = { b.x - a.x, b.y - a.y, b.z - a.z };
+    Vec3 e2 = { c.x - a.x, c.y - a.y, c.z - a.z };
+    Vec3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+    float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+    if(length > 0.0f)
+    {
+        n.x /= length;
+        n.y /= length;
+        n.z /= length;
+    }
+    return n;
+}
+
+//read an obj file into a flat triangle list
+static bool readObj(const std::string& path, std::vector<Vertex>& vertices)
+{
+    std::ifstream file(path);
+    if(!file.is_open())
+    {
+        std::cout << "Could not open " << path << std::endl;
+        return false;
+    }
+
+    std::vector<Vec3> positions;
+    std::vector<Vec3> normals;
+
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(file, line))
+    {
+        lineNumber++;
+
+        std::istringstream stream(line);
+        std::string type;
+        stream >> type;
+
+        if(type == "v")
+        {
+            Vec3 p;
+            stream >> p.x >> p.y >> p.z;
+            positions.push_back(p);
+        }
+        else if(type == "vn")
+        {
+            Vec3 n;
+            stream >> n.x >> n.y >> n.z;
+            normals.push_back(n);
+        }
+        else if(type == "f")
+        {
+            //corners as position/normal index pairs, -1 when the normal is missing
+            std::vector<std::pair<int, int>> corners;
+            std::string corner;
+            while(stream >> corner)
+            {
+                int position = 0, normal = 0;
+                std::size_t firstSlash = corner.find('/');
+                position = std::stoi(corner.substr(0, firstSlash));
+                if(firstSlash != std::string::npos)
+                {
+                    std::size_t secondSlash = corner.find('/', firstSlash + 1);
+                    if(secondSlash != std::string::npos && secondSlash + 1 < corner.size())
+                    {
+                        normal = std::stoi(corner.substr(secondSlash + 1));
+                    }
+                }
+
+                //negative indices are relative to the end of the list
+                if(position < 0) position += int(positions.size()) + 1;
+                if(normal < 0) normal += int(normals.size()) + 1;
+
+                if(position < 1 || position > int(positions.size()) || normal > int(normals.size()))
+                {
+                    std::cout << path << ":" << lineNumber << ": index out of range" << std::endl;
+                    return false;
+                }
+                corners.push_back(std::make_pair(position - 1, normal - 1));
+            }
+
+            //triangle fan
+            for(std::size_t i = 2; i < corners.size(); i++)
+            {
+                std::pair<int, int> triangle[3] = { corners[0], corners[i - 1], corners[i] };
+                Vec3 flat = faceNormal(positions[triangle[0].first], positions[triangle[1].first], positions[triangle[2].first]);
+
+                for(auto& c : triangle)
+                {
+                    Vertex v;
+                    v.position = positions[c.first];
+                    v.normal = c.second >= 0 ? normals[c.second] : flat;
+                    vertices.push_back(v);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static std::string meshName(const std::string& path)
+{
+    std::size_t begin = path.find_last_of("/\\");
+    begin = (begin == std::string::npos) ? 0 : begin + 1;
+    std::size_t end = path.find_last_of('.');
+    if(end == std::string::npos || end < begin)
+    {
+        end = path.size();
+    }
+    return path.substr(begin, end - begin);
+}
+
+static uint64_t align(uint64_t offset)
+{
+    return (offset + MESH_ARCHIVE_ALIGNMENT - 1) / MESH_ARCHIVE_ALIGNMENT * MESH_ARCHIVE_ALIGNMENT;
+}
+
+int main(int argc, char** argv)
+{
+    bool quantize = false;
+    std::vector<std::string> arguments;
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::string(argv[i]) == "--quantize")
+        {
+            quantize = true;
+        }
+        else
+        {
+            arguments.push_back(argv[i]);
+        }
+    }
+
+    if(arguments.size() < 2)
+    {
+        std::cout << "usage: MeshPacker [--quantize] output.pak mesh1.obj [mesh2.obj ...]" << std::endl;
+        return 1;
+    }
+
+    std::vector<MeshArchiveEntry> entries;
+    std::vector<std::vector<char>> blobs;
+
+    for(std::size_t i = 1; i < arguments.size(); i++)
+    {
+        std::vector<Vertex> vertices;
+        if(!readObj(arguments[i], vertices))
+        {
+            return 1;
+        }
+
+        std::string name = meshName(arguments[i]);
+        if(name.size() >= MESH_ARCHIVE_NAME_LENGTH)
+        {
+            std::cout << "Mesh name too long: " << name << std::endl;
+            return 1;
+        }
+
+        MeshArchiveEntry entry = {};
+        std::strncpy(entry.name, name.c_str(), MESH_ARCHIVE_NAME_LENGTH - 1);
+        entry.vertexCount = uint32_t(vertices.size());
+
+        std::vector<char> blob;
+        if(quantize)
+        {
+            entry.format = MESH_FORMAT_QUANTIZED;
+            entry.stride = 12;
+            blob.resize(vertices.size() * entry.stride);
+
+            for(std::size_t v = 0; v < vertices.size(); v++)
+            {
+                uint16_t position[4] = { toHalf(vertices[v].position.x), toHalf(vertices[v].position.y), toHalf(vertices[v].position.z), 0 };
+                uint32_t normal = packNormal(vertices[v].normal);
+                std::memcpy(&blob[v * entry.stride], position, sizeof(position));
+                std::memcpy(&blob[v * entry.stride + 8], &normal, sizeof(normal));
+            }
+        }
+        else
+        {
+            entry.format = MESH_FORMAT_FLOAT;
+            entry.stride = sizeof(Vertex);
+            blob.resize(vertices.size() * entry.stride);
+            std::memcpy(blob.data(), vertices.data(), blob.size());
+        }
+        entry.dataSize = blob.size();
+
+        std::cout << name << ": " << vertices.size() << " vertices, " << blob.size() << " bytes" << std::endl;
+
+        entries.push_back(entry);
+        blobs.push_back(blob);
+    }
+
+    //lay out the data blocks after the entry table
+    MeshArchiveHeader header;
+    std::memcpy(header.magic, MESH_ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = MESH_ARCHIVE_VERSION;
+    header.meshCount = uint32_t(entries.size());
+    header.entryOffset = sizeof(MeshArchiveHeader);
+
+    uint64_t offset = header.entryOffset + entries.size() * sizeof(MeshArchiveEntry);
+    for(auto& entry : entries)
+    {
+        offset = align(offset);
+        entry.dataOffset = offset;
+        offset += entry.dataSize;
+    }
+
+    std::ofstream output(arguments[0], std::ios::binary);
+    if(!output.is_open())
+    {
+        std::cout << "Could not open " << arguments[0] << std::endl;
+        return 1;
+    }
+
+    output.write((const char*)&header, sizeof(header));
+    output.write((const char*)entries.data(), entries.size() * sizeof(MeshArchiveEntry));
+
+    uint64_t written = header.entryOffset + entries.size() * sizeof(MeshArchiveEntry);
+    for(std::size_t i = 0; i < entries.size(); i++)
+    {
+        std::vector<char> padding(std::size_t(entries[i].dataOffset - written), 0);
+        output.write(padding.data(), padding.size());
+        output.write(blobs[i].data(), blobs[i].size());
+        written = entries[i].dataOffset + entries[i].dataSize;
+    }
+
+    std::cout << "Wrote " << arguments[0] << " (" << written << " bytes)" << std::endl;
+    return 0;
+}